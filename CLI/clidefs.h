@@ -10,9 +10,12 @@
 
 constexpr char board_value_csv[] = "board_value.csv";
 constexpr char board_value_dat[] = "board_value.dat";
+constexpr char card_play_transitions_inc[] = "CardPlayTransitions.inc";
 constexpr char disc_net_hand_dat[] = "disc_net_hand.dat";
 constexpr char disc_net_show_dat[] = "disc_net_show.dat";
 constexpr char hand_vs_hand_dat[] = "hand_vs_hand.dat";
+constexpr char hand_vs_hand_part_dat[] = "hand_vs_hand_part.dat";
+constexpr char opening_book_dat[] = "opening_book.dat";
 constexpr char score_log_dat[] = "score_log.dat";
 
 #endif /* clidefs_h */
@@ -5,15 +5,22 @@
 // license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
 //
 
+#include <charconv>
+#include <chrono>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <limits>
 #include <string>
+#include <vector>
 #include "clidefs.h"
 #include "BoardValue.h"
+#include "CardPlayScore.h"
 #include "DiscardSimulator.h"
+#include "FictitiousPlay.h"
 #include "Match.h"
 #include "MinimaxPlayer.h"
+#include "OpeningBook.h"
 #include "ScoreLogger.h"
 
 // Converts the raw board value data into a comma-delimited file suitable for
@@ -59,10 +66,179 @@ int gen_board_value_dat()
    return 0;
 }
 
-// Shared function for generating a discard table. If use_hvh is false, it
-// computes the best strategy considering only the show, i.e., it doesn't
-// consider points scored during card play.
-int gen_disc_dat(bool use_hvh)
+// Merges results simulated by other processes. Results simulated against a
+// different strategy are skipped, since they don't apply to this one. This
+// happens when a run is restarted after its first iteration.
+bool merge_results(DiscardSimulator& simulator,
+                   const std::vector<std::string>& merge_files)
+{
+   for (const auto& merge_file : merge_files) {
+      if (!simulator.matches(merge_file.c_str())) {
+         std::cout << "Skipping " << merge_file
+                   << " -- doesn't match the current strategy." << std::endl;
+         continue;
+      }
+      if (!simulator.merge(merge_file.c_str())) {
+         std::cerr << "Failed to merge " << merge_file << std::endl;
+         return false;
+      }
+      std::cout << "Merged " << merge_file << std::endl;
+   }
+   return true;
+}
+
+// Simulates the best response to a discard table and returns the table's
+// exploitability. Interrupted evaluations resume from the checkpoint, which is
+// only loaded if it was simulated against the same table.
+double evaluate_table(const DiscardTable& table,
+                      const HandVsHand& hvh,
+                      int64_t max_hands,
+                      const DiscardSimulator::StoppingRule& rule,
+                      const std::string& checkpoint)
+{
+   DiscardSimulator simulator(table,
+                              hvh,
+                              DiscardSimulator::Mode::all_starters);
+   simulator.set_importance_sampling(true);
+   if (simulator.load(checkpoint.c_str())) {
+      std::cout << "Resuming from " << checkpoint << std::endl;
+   }
+   simulator.set_checkpoint(checkpoint.c_str(), std::chrono::minutes(15));
+   auto num_hands = simulator.simulate(
+      std::max<int64_t>(max_hands - simulator.num_hands(), 0),
+      rule
+   );
+   std::cout << "Hands simulated for evaluation: " << num_hands << std::endl;
+   std::remove(checkpoint.c_str());
+   DiscardTable response;
+   return simulator.best_response(response);
+}
+
+// Solves for a discard table with fictitious play, starting from the given
+// strategy. Unlike repeated best responses, the simulation results from every
+// iteration are kept, so each iteration can simulate fewer hands. The table
+// saved is the action played most often by the average strategy. Its
+// exploitability is measured with a separate best response simulation every
+// few iterations.
+int solve_fictitious_play(const DiscardTable& initial,
+                          const HandVsHand& hvh,
+                          const char* filename,
+                          const std::vector<std::string>& merge_files)
+{
+   // Each iteration ends once every hand has been decided vs. the latest
+   // strategy or the budget runs out, whichever comes first.
+   DiscardSimulator::StoppingRule rule;
+   rule.budget = std::chrono::hours(2);
+
+   const int64_t hands_per_iteration = 1'000'000'000;
+   const auto max_iterations = 32;
+   // Evaluating the saved table costs as much as an iteration, so it's only
+   // done every few iterations and after the last one.
+   const auto eval_interval = 4;
+   const auto checkpoint = std::string(filename) + ".ckpt";
+   const auto eval_checkpoint = std::string(filename) + ".eval.ckpt";
+   const auto solver_file = std::string(filename) + ".fp";
+
+   FictitiousPlay solver(initial);
+   if (solver.load(solver_file.c_str())) {
+      std::cout << "Resuming from " << solver_file << std::endl;
+   }
+
+   while (solver.num_iterations() <= max_iterations) {
+      std::cout << "Iteration: " << solver.num_iterations() << std::endl;
+      double estimate;
+      // Scoped, so the simulator's results are freed before the saved table
+      // is evaluated.
+      {
+         auto opponent = solver.current();
+         DiscardSimulator simulator(opponent,
+                                    hvh,
+                                    DiscardSimulator::Mode::all_starters);
+         simulator.set_importance_sampling(true);
+         // Any merged results are already included in the checkpoint.
+         auto resumed = simulator.load(checkpoint.c_str());
+         if (resumed) {
+            std::cout << "Resuming from " << checkpoint << std::endl;
+         }
+         if ((solver.num_iterations() == 1) &&
+             !resumed &&
+             !merge_results(simulator, merge_files)) {
+            return -1;
+         }
+         simulator.set_checkpoint(checkpoint.c_str(),
+                                  std::chrono::minutes(15));
+         auto num_hands = simulator.simulate(
+            std::max<int64_t>(hands_per_iteration - simulator.num_hands(), 0),
+            rule
+         );
+         std::cout << "Hands simulated: " << num_hands << std::endl;
+         estimate = solver.update(simulator);
+      }
+      std::cout << "Total hands: " << solver.num_hands() << std::endl;
+      std::cout << "Exploitability of mixed average (estimate): " << estimate
+                << std::endl;
+
+      // Save the solver before removing the checkpoint, so an interruption
+      // never loses the iteration.
+      auto tmp = solver_file + ".tmp";
+      solver.save(tmp.c_str());
+      std::rename(tmp.c_str(), solver_file.c_str());
+      std::remove(checkpoint.c_str());
+
+      // The estimate is for the mixed average, not the pure table saved, so
+      // it can't be used to choose between tables. The latest average is
+      // built from the most results.
+      auto average = solver.average();
+      average.save(filename);
+
+      // The hands simulated so far can be compared to iterated best response
+      // to reach the same exploitability.
+      if (((solver.num_iterations() - 1) % eval_interval == 0) ||
+          (solver.num_iterations() > max_iterations)) {
+         auto exploit = evaluate_table(average,
+                                       hvh,
+                                       hands_per_iteration,
+                                       rule,
+                                       eval_checkpoint);
+         std::cout << "Exploitability of average table: " << exploit
+                   << " (estimate for mixed average: " << estimate << ")"
+                   << std::endl;
+      }
+   }
+
+   return 0;
+}
+
+// Generates the transition table for CardPlayAutomaton as C++ source, which
+// is compiled into GameModel. Only needs to be rerun if the rules for scoring
+// card play change.
+int gen_card_play_transitions_inc()
+{
+   auto table = CardPlayAutomaton::build();
+   if (table.size() != CardPlayAutomaton::num_states) {
+      std::cerr << "Update CardPlayAutomaton::num_states to " << table.size()
+                << std::endl;
+      return -1;
+   }
+
+   std::ofstream ostrm(card_play_transitions_inc, std::ios::trunc);
+   ostrm << "// Generated by gen_file " << card_play_transitions_inc
+         << " -- do not edit.\n"
+         << "// Each line is a state: the next state and points for each rank."
+         << std::endl;
+   for (const auto& row : table) {
+      for (const auto& transition : row) {
+         ostrm << transition.next << ","
+               << static_cast<int>(transition.points) << ",";
+      }
+      ostrm << "\n";
+   }
+   return 0;
+}
+
+// Returns the strategy to start from when generating a discard table, which
+// is the latest table generated if there is one.
+DiscardTable load_disc_strategy(bool use_hvh)
 {
    DiscardTable strategy;
    if (use_hvh && strategy.load(disc_net_hand_dat)) {
@@ -73,6 +249,22 @@ int gen_disc_dat(bool use_hvh)
       strategy = generate_greedy_strategy();
       std::cout << "Starting with greedy strategy." << std::endl;
    }
+   return strategy;
+}
+
+// Shared function for generating a discard table. If use_hvh is false, it
+// computes the best strategy considering only the show, i.e., it doesn't
+// consider points scored during card play. If fictitious_play is true, the
+// table is solved with fictitious play instead of repeated best responses.
+//
+// Progress is checkpointed periodically, so an interrupted run resumes where
+// it left off. Results from other processes can be merged into the first
+// iteration, provided they were simulated against the same strategy.
+int gen_disc_dat(bool use_hvh,
+                 bool fictitious_play,
+                 const std::vector<std::string>& merge_files)
+{
+   auto strategy = load_disc_strategy(use_hvh);
 
    HandVsHand hvh;
    if (use_hvh && !hvh.load(hand_vs_hand_dat)) {
@@ -80,13 +272,49 @@ int gen_disc_dat(bool use_hvh)
       return -1;
    }
 
+   const auto filename = use_hvh ? disc_net_hand_dat : disc_net_show_dat;
+   if (fictitious_play) {
+      return solve_fictitious_play(strategy, hvh, filename, merge_files);
+   }
+
+   // Each iteration ends once every hand has been decided or the budget runs
+   // out, whichever comes first.
+   DiscardSimulator::StoppingRule rule;
+   rule.budget = std::chrono::hours(12);
+
+   const int64_t target_hands = 10'000'000'000;
+   const auto checkpoint = std::string(filename) + ".ckpt";
+
    auto iteration = 0;
    auto lowest_exploit = std::numeric_limits<double>::max();
 
    while (true) {
-      DiscardSimulator simulator(strategy, hvh);
+      // Averaging over every starter costs little more per deal than sampling
+      // one, and it halves the variance.
+      DiscardSimulator simulator(strategy,
+                                 hvh,
+                                 DiscardSimulator::Mode::all_starters);
+      // Once most hands are decided, spend the deals on the ones that aren't.
+      simulator.set_importance_sampling(true);
       std::cout << "Iteration: " << iteration << std::endl;
-      simulator.simulate(10'000'000'000);
+      // The checkpoint is only loaded if it matches the current strategy, and
+      // any merged results are already included in it.
+      auto resumed = simulator.load(checkpoint.c_str());
+      if (resumed) {
+         std::cout << "Resuming from " << checkpoint << std::endl;
+      }
+      if ((iteration == 0) &&
+          !resumed &&
+          !merge_results(simulator, merge_files)) {
+         return -1;
+      }
+      simulator.set_checkpoint(checkpoint.c_str(), std::chrono::minutes(15));
+      auto num_hands = simulator.simulate(
+         std::max<int64_t>(target_hands - simulator.num_hands(), 0),
+         rule
+      );
+      std::cout << "Hands simulated: " << num_hands << std::endl;
+      std::cout << "Total hands: " << simulator.num_hands() << std::endl;
       auto exploit = simulator.best_response(strategy);
       std::cout << "Exploitability: " << exploit << std::endl;
 
@@ -95,8 +323,10 @@ int gen_disc_dat(bool use_hvh)
          break;
       }
 
-      // Save our new best strategy.
-      strategy.save(use_hvh ? disc_net_hand_dat : disc_net_show_dat);
+      // Save our new best strategy. Any checkpoint for the old strategy is
+      // now obsolete.
+      strategy.save(filename);
+      std::remove(checkpoint.c_str());
 
       lowest_exploit = exploit;
       ++iteration;
@@ -106,26 +336,145 @@ int gen_disc_dat(bool use_hvh)
 }
 
 // Generates the discard table that maximizes the expected net points scored
-// during the show (i.e., ignoring points scored during card play).
-int gen_disc_net_hand_dat()
+// during the entire hand (i.e., including points scored during card play).
+int gen_disc_net_hand_dat(bool fictitious_play,
+                          const std::vector<std::string>& merge_files)
 {
-   return gen_disc_dat(true);
+   return gen_disc_dat(true, fictitious_play, merge_files);
+}
+
+// Simulates hands against the current disc_net_hand.dat and saves the
+// results to the given file, so they can be merged into the first iteration
+// of gen_disc_net_hand_dat. This allows the simulation to be split across
+// independent processes. The file doubles as a checkpoint, so an interrupted
+// run resumes where it left off.
+int simulate_disc_net_hand(int64_t num_hands, const char* filename)
+{
+   auto strategy = load_disc_strategy(true);
+
+   HandVsHand hvh;
+   if (!hvh.load(hand_vs_hand_dat)) {
+      std::cerr << "Failed to load " << hand_vs_hand_dat << std::endl;
+      return -1;
+   }
+
+   // Must use the same mode as gen_disc_dat, or the results can't be merged.
+   DiscardSimulator simulator(strategy,
+                              hvh,
+                              DiscardSimulator::Mode::all_starters);
+   if (simulator.load(filename)) {
+      std::cout << "Resuming from " << filename << std::endl;
+   }
+   simulator.set_checkpoint(filename, std::chrono::minutes(15));
+   simulator.simulate(std::max<int64_t>(num_hands - simulator.num_hands(), 0));
+   simulator.save(filename);
+   std::cout << "Total hands: " << simulator.num_hands() << std::endl;
+   return 0;
 }
 
 // Generates the discard table that maximizes the expected net points scored
-// during the entire hand (i.e., including points scored during card play).
+// during the show (i.e., ignoring points scored during card play).
 int gen_disc_net_show_dat()
 {
-   return gen_disc_dat(false);
+   return gen_disc_dat(false, false, {});
+}
+
+// Rewrites an existing discard table in the current format. Tables in the
+// legacy map format must be read into memory, whereas the current format is
+// memory-mapped, so this makes loading them nearly instant.
+int convert_disc_dat(const char* filename)
+{
+   DiscardTable table;
+   if (!table.load(filename)) {
+      std::cerr << "Failed to load " << filename << std::endl;
+      return -1;
+   }
+   // The table may be mapped from the file itself, so it can't be saved over
+   // the file directly.
+   auto tmp = std::string(filename) + ".tmp";
+   table.save(tmp.c_str());
+   if (std::rename(tmp.c_str(), filename) != 0) {
+      std::cerr << "Failed to replace " << filename << std::endl;
+      return -1;
+   }
+   std::cout << "Converted " << filename << std::endl;
+   return 0;
+}
+
+// Builds the rows in [first, last) of the table, checkpointing to the given
+// file and reporting progress along the way. The rows are built in a single
+// pass, so the workers keep their transposition tables throughout.
+void build_hand_vs_hand(HandVsHand& hvh,
+                        int first,
+                        int last,
+                        const char* checkpoint)
+{
+   hvh.set_checkpoint(checkpoint, std::chrono::minutes(15));
+   hvh.set_progress([](int rows_built) {
+      std::cout << "Rows built: " << rows_built << "/"
+                << HandVsHand::num_hands << std::endl;
+   }, std::chrono::minutes(1));
+   hvh.build(first, last);
 }
 
 // Generates the table of outcomes for all possible combinations of card play
-// hands.
-int gen_hand_vs_hand_dat()
+// hands. Progress is checkpointed periodically, so an interrupted run resumes
+// where it left off. Partial tables built by other processes can be merged
+// in, so only the remaining rows are built.
+int gen_hand_vs_hand_dat(const std::vector<std::string>& merge_files)
 {
+   const auto checkpoint = std::string(hand_vs_hand_dat) + ".ckpt";
+
    HandVsHand hvh;
-   hvh.build();
+   if (hvh.load_partial(checkpoint.c_str())) {
+      std::cout << "Resuming from " << checkpoint << std::endl;
+   }
+   for (const auto& merge_file : merge_files) {
+      if (!hvh.merge(merge_file.c_str())) {
+         std::cerr << "Failed to merge " << merge_file << std::endl;
+         return -1;
+      }
+      std::cout << "Merged " << merge_file << std::endl;
+   }
+   build_hand_vs_hand(hvh, 0, HandVsHand::num_hands, checkpoint.c_str());
    hvh.save(hand_vs_hand_dat);
+   std::remove(checkpoint.c_str());
+   return 0;
+}
+
+// Returns the name of the partial table holding the rows in [first, last).
+// The range is part of the name, so processes building different ranges in
+// the same directory don't clobber each other's files.
+std::string hand_vs_hand_part_name(int first, int last)
+{
+   std::string name(hand_vs_hand_part_dat);
+   auto ext = name.rfind('.');
+   return name.substr(0, ext) + "_" + std::to_string(first) + "_" +
+          std::to_string(last) + name.substr(ext);
+}
+
+// Generates a partial table containing only the rows in [first, last). This
+// allows the table to be split across independent processes.
+int gen_hand_vs_hand_part_dat(int first, int last)
+{
+   const auto filename = hand_vs_hand_part_name(first, last);
+
+   HandVsHand hvh;
+   if (hvh.load_partial(filename.c_str())) {
+      std::cout << "Resuming from " << filename << std::endl;
+   }
+   build_hand_vs_hand(hvh, first, last, filename.c_str());
+   hvh.save_partial(filename.c_str(), first, last);
+   std::cout << "Saved " << filename << std::endl;
+   return 0;
+}
+
+// Generates the best lead for every pone hand.
+int gen_opening_book_dat()
+{
+   OpeningBook book;
+   book.build();
+   book.save(opening_book_dat);
    return 0;
 }
 
@@ -163,19 +512,72 @@ int gen_score_log_dat()
    return 0;
 }
 
+// Converts a string argument to an integer. Returns true if the conversion
+// succeeds. Leaves value unmodified if the conversion fails.
+template<typename T>
+bool get_arg_value(const std::string& s, T& value)
+{
+   T tmp;
+   auto last = s.data() + s.size();
+   auto [end, ec] = std::from_chars(s.data(), last, tmp);
+   if ((ec != std::errc()) || (end != last)) {
+      return false;
+   }
+   value = tmp;
+   return true;
+}
+
+// Selects fictitious play when generating disc_net_hand.dat.
+constexpr char fictitious_play_flag[] = "--fictitious-play";
+// Simulates hands for disc_net_hand.dat to merge into another process.
+constexpr char simulate_flag[] = "--simulate";
+// Rewrites a discard table in the current file format.
+constexpr char convert_flag[] = "--convert";
+
 int show_usage()
 {
    std::cout
-      << "Usage: gen_file <filename>\n"
+      << "Usage: gen_file <filename> [results ...]\n"
       << "\n"
       << "Valid filenames:\n"
       << "   " << board_value_csv << "\n"
       << "   " << board_value_dat << "\n"
+      << "   " << card_play_transitions_inc << "\n"
       << "   " << disc_net_hand_dat << "\n"
       << "   " << disc_net_show_dat << "\n"
       << "   " << hand_vs_hand_dat << "\n"
+      << "   " << hand_vs_hand_part_dat << "\n"
+      << "   " << opening_book_dat << "\n"
       << "   " << score_log_dat << "\n"
       << "\n"
+      << "For " << disc_net_hand_dat << ", any additional arguments are "
+      << "simulation results\n"
+      << "from other processes to merge into the first iteration. If the "
+      << "first argument\n"
+      << "is " << fictitious_play_flag << ", the table is solved with "
+      << "fictitious play instead of\n"
+      << "repeated best responses. If the first argument is " << simulate_flag
+      << ",\n"
+      << "the next arguments are the number of hands to simulate against the "
+      << "current\n"
+      << "table and the file to save the results to for merging.\n"
+      << "\n"
+      << "For " << disc_net_hand_dat << " and " << disc_net_show_dat
+      << ", if the only argument is " << convert_flag << ",\n"
+      << "the existing table is rewritten in the current format, so it can "
+      << "be memory-mapped.\n"
+      << "\n"
+      << "For " << hand_vs_hand_dat << ", any additional arguments are "
+      << "partial tables to\n"
+      << "merge before building the remaining rows.\n"
+      << "\n"
+      << "For " << hand_vs_hand_part_dat << ", the arguments are the first "
+      << "and last (exclusive)\n"
+      << "rows to build. Row numbers range from 0 to "
+      << HandVsHand::num_hands << ". The partial table is\n"
+      << "saved with the range in its name, e.g., "
+      << hand_vs_hand_part_name(0, HandVsHand::num_hands) << ".\n"
+      << "\n"
       << "Example: gen_file disc_net_hand.dat\n"
       << std::endl;
 
@@ -184,21 +586,64 @@ int show_usage()
 
 int main(int argc, char* const argv[])
 {
-   if (argc != 2) {
+   if (argc < 2) {
       return show_usage();
    }
 
    std::string filename(argv[1]);
+   std::vector<std::string> merge_files(argv + 2, argv + argc);
+   if (((filename == disc_net_hand_dat) || (filename == disc_net_show_dat)) &&
+       (merge_files.size() == 1) &&
+       (merge_files.front() == convert_flag)) {
+      return convert_disc_dat(filename.c_str());
+   }
+   auto fictitious_play = false;
+   if ((filename == disc_net_hand_dat) &&
+       !merge_files.empty() &&
+       (merge_files.front() == fictitious_play_flag)) {
+      fictitious_play = true;
+      merge_files.erase(merge_files.begin());
+   }
+   if ((filename == disc_net_hand_dat) &&
+       !merge_files.empty() &&
+       (merge_files.front() == simulate_flag)) {
+      int64_t num_hands;
+      if ((merge_files.size() != 3) ||
+          !get_arg_value(merge_files[1], num_hands) ||
+          (num_hands <= 0)) {
+         return show_usage();
+      }
+      return simulate_disc_net_hand(num_hands, merge_files[2].c_str());
+   }
+   if (filename == hand_vs_hand_part_dat) {
+      int first, last;
+      if ((merge_files.size() != 2) ||
+          !get_arg_value(merge_files[0], first) ||
+          !get_arg_value(merge_files[1], last) ||
+          (first < 0) || (first >= last) || (last > HandVsHand::num_hands)) {
+         return show_usage();
+      }
+      return gen_hand_vs_hand_part_dat(first, last);
+   }
+   if (!merge_files.empty() &&
+       (filename != disc_net_hand_dat) &&
+       (filename != hand_vs_hand_dat)) {
+      return show_usage();
+   }
    if (filename == board_value_csv) {
       return gen_board_value_csv();
    } else if (filename == board_value_dat) {
       return gen_board_value_dat();
+   } else if (filename == card_play_transitions_inc) {
+      return gen_card_play_transitions_inc();
    } else if (filename == disc_net_hand_dat) {
-      return gen_disc_net_hand_dat();
+      return gen_disc_net_hand_dat(fictitious_play, merge_files);
    } else if (filename == disc_net_show_dat) {
       return  gen_disc_net_show_dat();
    } else if (filename == hand_vs_hand_dat) {
-      return gen_hand_vs_hand_dat();
+      return gen_hand_vs_hand_dat(merge_files);
+   } else if (filename == opening_book_dat) {
+      return gen_opening_book_dat();
    } else if (filename == score_log_dat) {
       return gen_score_log_dat();
    }
@@ -6,6 +6,8 @@
 //
 
 #include <charconv>
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <string_view>
@@ -14,11 +16,18 @@
 #include "GreedyPlayer.h"
 #include "Match.h"
 #include "MinimaxPlayer.h"
+#include "OpeningBook.h"
 #include "RandomPlayer.h"
 
 using DiscarderPtr = std::unique_ptr<Discarder>;
 using PlayerPtr = std::unique_ptr<Player>;
 
+// Per-move budget for the time-limited minimax player.
+constexpr std::chrono::milliseconds card_play_budget{5};
+
+// Shares a cache of card play decisions between the minimax players.
+constexpr char cache_flag[] = "--cache";
+
 DiscarderPtr build_discarder(char descriptor)
 {
    switch (descriptor) {
@@ -45,8 +54,14 @@ DiscarderPtr build_discarder(char descriptor)
    return nullptr;
 }
 
-PlayerPtr build_player(char descriptor, Discarder& discarder)
+// The opening book and the cache are optional, so either may be null.
+PlayerPtr build_player(char descriptor,
+                       Discarder& discarder,
+                       const OpeningBook* book,
+                       SolveCache* cache)
 {
+   std::unique_ptr<MinimaxPlayer> minimax;
+
    switch (descriptor) {
       case 'r':
          return std::make_unique<RandomPlayer>(discarder);
@@ -57,14 +72,23 @@ PlayerPtr build_player(char descriptor, Discarder& discarder)
          break;
 
       case 'm':
-         return std::make_unique<MinimaxPlayer>(discarder);
+         minimax = std::make_unique<MinimaxPlayer>(discarder);
          break;
 
-      default:
+      case 't':
+         minimax = std::make_unique<MinimaxPlayer>(
+            discarder,
+            false,
+            MinimaxStrategy::Budget{ card_play_budget });
          break;
+
+      default:
+         return nullptr;
    }
 
-   return nullptr;
+   minimax->set_opening_book(book);
+   minimax->set_solve_cache(cache);
+   return minimax;
 }
 
 // Converts a string argument to int. Returns true if the conversion succeeds.
@@ -83,7 +107,8 @@ bool get_arg_value(const std::string_view& sv, int& value)
 int show_usage()
 {
    std::cout
-      << "Usage: play_match <player 1> <player 2> <number of games>\n"
+      << "Usage: play_match <player 1> <player 2> <number of games> "
+      << "[" << cache_flag << "]\n"
       << "\n"
       << "Players are specified by two characters, the first indicating the discard\n"
       << "strategy and the second the card play strategy.\n"
@@ -98,6 +123,16 @@ int show_usage()
       << "    r - Random\n"
       << "    g - Greedy\n"
       << "    m - Monte Carlo minimax\n"
+      << "    t - Monte Carlo minimax limited to "
+      << card_play_budget.count() << " ms per play\n"
+      << "\n"
+      << "If " << cache_flag << " is given, the minimax players share a "
+      << "cache of card play\n"
+      << "decisions. The key includes every rank seen, so decisions rarely "
+      << "recur across\n"
+      << "deals. The cache mostly pays off when both players use the same "
+      << "strategy, since\n"
+      << "each deal is replayed with the seats swapped.\n"
       << "\n"
       << "Example: play_match gg hm 1000\n"
       << std::endl;
@@ -107,7 +142,7 @@ int show_usage()
 
 int main(int argc, char* const argv[])
 {
-   if (argc != 4) {
+   if ((argc != 4) && ((argc != 5) || (strcmp(argv[4], cache_flag) != 0))) {
       return show_usage();
    }
 
@@ -125,8 +160,25 @@ int main(int argc, char* const argv[])
       return show_usage();
    }
 
-   PlayerPtr player1 = build_player(desc1[1], *discarder1);
-   PlayerPtr player2 = build_player(desc2[1], *discarder2);
+   // Minimax players consult the opening book if it's been generated.
+   OpeningBook book;
+   auto book_ptr = book.load(opening_book_dat) ? &book : nullptr;
+
+   // The cache is opt-in. It's 16 MB and every lookup takes a lock, but it
+   // only gets hits when the same decision comes up again.
+   std::unique_ptr<SolveCache> cache;
+   if (argc == 5) {
+      cache = std::make_unique<SolveCache>();
+   }
+
+   PlayerPtr player1 = build_player(desc1[1],
+                                    *discarder1,
+                                    book_ptr,
+                                    cache.get());
+   PlayerPtr player2 = build_player(desc2[1],
+                                    *discarder2,
+                                    book_ptr,
+                                    cache.get());
    if (!player1 || !player2) {
       return show_usage();
    }
@@ -142,5 +194,12 @@ int main(int argc, char* const argv[])
    std::cout << "Player 1: " << results.wins[0] << " wins" << std::endl;
    std::cout << "Player 2: " << results.wins[1] << " wins" << std::endl;
 
+   auto stats = cache ? cache->stats() : SolveCache::Stats{ 0, 0 };
+   if (stats.lookups > 0) {
+      std::cout << "Card play cache: " << stats.hits << " hits in "
+                << stats.lookups << " lookups ("
+                << 100.0 * stats.hit_rate() << "%)" << std::endl;
+   }
+
    return 0;
 }
@@ -0,0 +1,184 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#include "BeliefMinimax.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// Lines of play transpose so often that most lanes near the leaves have
+// already been searched, but the last few plays are cheaper to search than
+// to look up.
+constexpr int min_cards_for_lookup = 3;
+
+} // namespace
+
+void BeliefMinimax::add_hand(const RanksInHand& hand, int combos)
+{
+   assert(hands_.size() < std::numeric_limits<uint16_t>::max());
+   hands_.push_back(CardPlayNode::pack(hand));
+   combos_.push_back(combos);
+}
+
+BeliefMinimax::Results BeliefMinimax::solve(TranspositionTable& table,
+                                            const CardPlayNode& root,
+                                            const RanksInHand& plays)
+{
+   assert(root.is_current_player());
+   Results results(plays.size(), 0);
+   auto num_lanes = num_hands();
+   if (num_lanes == 0) {
+      return results;
+   }
+
+   // A series holds at least one card and ends after at most two gos, so
+   // there are at most three plays per card left. Size every level up front,
+   // so references stay valid during the search.
+   auto num_levels = std::max<size_t>(levels_.size(), 3 * root.cards_left());
+   levels_.resize(num_levels);
+   for (auto& level : levels_) {
+      if (level.hands.size() < num_lanes) {
+         level.hands.resize(num_lanes);
+         level.values.resize(num_lanes);
+         level.sources.resize(num_lanes);
+      }
+   }
+
+   table_ = &table;
+   num_nodes_ = 0;
+   timed_out_ = false;
+   auto& lanes = levels_[0];
+   for (auto j = 0; (j < plays.size()) && !timed_out_; ++j) {
+      std::copy(hands_.begin(), hands_.end(), lanes.hands.begin());
+      auto child = root[plays[j]];
+      if (child.is_terminal()) {
+         std::fill_n(lanes.values.begin(), num_lanes, 0);
+      } else {
+         search(child, 0, num_lanes);
+      }
+      for (auto i = 0; i < num_lanes; ++i) {
+         results[j] += (child.result() + lanes.values[i]) * combos_[i];
+      }
+   }
+   table_ = nullptr;
+   return results;
+}
+
+void BeliefMinimax::search(const CardPlayNode& node, int depth, int num_lanes)
+{
+   assert(!node.is_terminal());
+   if ((++num_nodes_ % nodes_per_check) == 0) {
+      timed_out_ = (Clock::now() >= deadline_);
+   }
+   if (timed_out_) {
+      return;
+   }
+   auto& lanes = levels_[depth];
+   if (node.is_current_player()) {
+      // The observer's hand is known, so every lane has the same plays.
+      std::fill_n(lanes.values.begin(),
+                  num_lanes,
+                  std::numeric_limits<Value>::min());
+      for (auto play : node.valid_plays()) {
+         search_child(node, node[play], depth, num_lanes, 0, false, 0);
+      }
+      return;
+   }
+
+   // Each play is only available to the lanes holding the card.
+   std::fill_n(lanes.values.begin(),
+               num_lanes,
+               std::numeric_limits<Value>::max());
+   const auto legal = CardPlayNode::legal_mask(node.count());
+   PackedHand held = 0;
+   for (auto i = 0; i < num_lanes; ++i) {
+      held |= lanes.hands[i];
+   }
+   held &= legal;
+   for (Rank rank = min_card_rank; rank <= max_card_rank; ++rank) {
+      auto bit = CardPlayNode::count_bit(rank);
+      if (bit > held) {
+         break;
+      }
+      if (CardPlayNode::contains(held, rank)) {
+         auto child = node;
+         child.make_play(rank, true);
+         auto mask = CardPlayNode::count_bit(rank + 1) - bit;
+         search_child(node, child, depth, num_lanes, mask, true, bit);
+      }
+   }
+   // Lanes without a legal play must say go.
+   auto child = node;
+   child.make_play(go_rank, true);
+   search_child(node, child, depth, num_lanes, legal, false, 0);
+}
+
+void BeliefMinimax::search_child(const CardPlayNode& node,
+                                 const CardPlayNode& child,
+                                 int depth,
+                                 int num_lanes,
+                                 PackedHand mask,
+                                 bool held,
+                                 PackedHand played)
+{
+   auto& lanes = levels_[depth];
+   auto& next = levels_[depth + 1];
+   const auto maximize = node.is_current_player();
+   const auto terminal = child.is_terminal();
+   const auto lookup = (child.cards_left() >= min_cards_for_lookup);
+   const Value points = child.result() - node.result();
+   const auto observer = child.key().observer;
+
+   auto merge = [maximize](Value& value, Value child_value) {
+      value = maximize ? std::max(value, child_value)
+                       : std::min(value, child_value);
+   };
+
+   // Gather the lanes that reach the child. Lanes that have already been
+   // searched are merged right away.
+   auto num_children = 0;
+   for (auto i = 0; i < num_lanes; ++i) {
+      if (((lanes.hands[i] & mask) != 0) != held) {
+         continue;
+      }
+      auto hand = lanes.hands[i] - played;
+      if (terminal) {
+         merge(lanes.values[i], points);
+         continue;
+      }
+      if (lookup) {
+         auto entry = table_->find({ observer, hand });
+         if (entry.bound == TranspositionTable::Bound::exact) {
+            merge(lanes.values[i], points + entry.value);
+            continue;
+         }
+      }
+      next.hands[num_children] = hand;
+      next.sources[num_children] = static_cast<uint16_t>(i);
+      ++num_children;
+   }
+   if (num_children == 0) {
+      return;
+   }
+
+   search(child, depth + 1, num_children);
+   if (timed_out_) {
+      // The child's values are incomplete, so don't merge or cache them.
+      return;
+   }
+   for (auto k = 0; k < num_children; ++k) {
+      merge(lanes.values[next.sources[k]], points + next.values[k]);
+   }
+   if (lookup) {
+      for (auto k = 0; k < num_children; ++k) {
+         table_->insert({ observer, next.hands[k] },
+                        next.values[k],
+                        TranspositionTable::Bound::exact);
+      }
+   }
+}
@@ -0,0 +1,108 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#ifndef BeliefMinimax_h
+#define BeliefMinimax_h
+
+#include "CardPlayNode.h"
+#include "SizedArray.h"
+#include "TranspositionTable.h"
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Solves the card play game for every possible opponent hand in a single walk
+// of the game tree. Each hand is a lane; the observer's moves are shared by all
+// lanes, and an opponent's move only carries forward the lanes that hold the
+// card. Per-lane hands and values are kept in flat per-depth arrays that are
+// reused across nodes.
+class BeliefMinimax
+{
+public:
+   using Results = SizedArray<int, num_cards_in_hand>;
+   using Clock = std::chrono::steady_clock;
+
+   // Adds a possible opponent hand with the given weight.
+   void add_hand(const RanksInHand& hand, int combos);
+   void clear() noexcept;
+   int num_hands() const noexcept;
+
+   // Returns the sum over all hands of the weighted minimax result of each
+   // play. The observer must be the current player. Exact values are shared
+   // through the table, so it can also be used by other searches.
+   Results solve(TranspositionTable& table,
+                 const CardPlayNode& root,
+                 const RanksInHand& plays);
+
+   // If the deadline passes, solve abandons the search and its results must
+   // be ignored.
+   void set_deadline(Clock::time_point deadline) noexcept;
+   // Returns true if the last call to solve was abandoned.
+   bool timed_out() const noexcept;
+
+private:
+   using PackedHand = CardPlayNode::PackedHand;
+   using Value = int16_t;
+
+   // Reading the clock is slow relative to searching a node, so the deadline
+   // is only checked periodically.
+   static constexpr int nodes_per_check = 1024;
+
+   // Lanes active at one depth of the tree.
+   struct Level
+   {
+      std::vector<PackedHand> hands;
+      std::vector<Value> values;
+      // Index of the lane in the parent level.
+      std::vector<uint16_t> sources;
+   };
+
+   // Computes the value of the node for the first num_lanes lanes of the level
+   // at the given depth.
+   void search(const CardPlayNode& node, int depth, int num_lanes);
+   // Searches the child for the lanes where the intersection of the hand and
+   // mask is non-empty if and only if 'held' is true. The played cards are
+   // removed from the hands, and the child's values are merged into the node's.
+   void search_child(const CardPlayNode& node,
+                     const CardPlayNode& child,
+                     int depth,
+                     int num_lanes,
+                     PackedHand mask,
+                     bool held,
+                     PackedHand played);
+
+   std::vector<PackedHand> hands_;
+   std::vector<int> combos_;
+   std::vector<Level> levels_;
+   TranspositionTable* table_ = nullptr;
+   Clock::time_point deadline_ = Clock::time_point::max();
+   int num_nodes_ = 0;
+   bool timed_out_ = false;
+};
+
+inline void BeliefMinimax::clear() noexcept
+{
+   hands_.clear();
+   combos_.clear();
+}
+
+inline int BeliefMinimax::num_hands() const noexcept
+{
+   return static_cast<int>(hands_.size());
+}
+
+inline void BeliefMinimax::set_deadline(Clock::time_point deadline) noexcept
+{
+   deadline_ = deadline;
+}
+
+inline bool BeliefMinimax::timed_out() const noexcept
+{
+   return timed_out_;
+}
+
+#endif /* BeliefMinimax_h */
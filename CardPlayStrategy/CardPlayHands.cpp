@@ -16,61 +16,65 @@ int RankCounts::remaining_combos(const RankCounts& hand) const noexcept
    return result;
 }
 
-const int RankCounts::Cprime[5][5] =
-{
-   { 1, 4, 6, 4, 1 },
-   { 1, 3, 3, 1, 0 },
-   { 1, 2, 1, 0, 0 },
-   { 1, 1, 0, 0, 0 },
-   { 1, 0, 0, 0, 0 }
+// Number of hands with each number of cards, i.e., multisets of ranks.
+constexpr std::array<int, num_cards_in_hand + 1> num_hands_by_size = {
+   1, 13, 91, 455, 1820
 };
 
-CardPlayHands::Hand::Hand(const Rank* begin, const Rank* end) noexcept
-{
-   for (auto rank = begin; rank != end; ++rank) {
-      hand.push_back(*rank);
-      counts += *rank;
+// Offset of the first hand of each size.
+constexpr auto hand_offsets = [](){
+   std::array<int, num_cards_in_hand + 2> result{};
+   for (auto i = 0; i <= num_cards_in_hand; ++i) {
+      result[i + 1] = result[i] + num_hands_by_size[i];
    }
-}
-
-const CardPlayHands& CardPlayHands::get() noexcept
-{
-   static CardPlayHands hands;
-   return hands;
-}
-
-CardPlayHands::CardPlayHands()
-{
-   // Add an empty entry for the case where no cards are left in the hand.
-   hands_[0].push_back(Hand());
+   return result;
+}();
 
+// Every possible hand grouped by number of cards. HandVsHand persists indices
+// into the four-card group, so the order must not change.
+constexpr auto all_hands = [](){
    // It's way easier to hardcode this for a standard Cribbage game than to
    // handle all possibilities.
    static_assert(num_cards_in_hand == 4);
    static_assert(num_card_suits >= 4);
 
-   std::array<Rank, num_cards_in_hand> ranks;
-   for (auto i0 = min_card_rank; i0 <= max_card_rank; ++i0) {
+   using Hand = CardPlayHands::Hand;
+   std::array<Hand, hand_offsets.back()> result{};
+   auto next = hand_offsets;
+   // The first entry is the empty hand for the case where no cards are left.
+   ++next[0];
+
+   std::array<Rank, num_cards_in_hand> ranks{};
+   for (Rank i0 = min_card_rank; i0 <= max_card_rank; ++i0) {
       ranks[0] = i0;
-      hands_[1].emplace_back(ranks.begin(), ranks.begin() + 1);
-      for (auto i1 = min_card_rank; i1 <= i0; ++i1) {
+      result[next[1]++] = Hand(ranks.begin(), ranks.begin() + 1);
+      for (Rank i1 = min_card_rank; i1 <= i0; ++i1) {
          ranks[1] = i1;
-         hands_[2].emplace_back(ranks.begin(), ranks.begin() + 2);
-         for (auto i2 = min_card_rank; i2 <= i1; ++i2) {
+         result[next[2]++] = Hand(ranks.begin(), ranks.begin() + 2);
+         for (Rank i2 = min_card_rank; i2 <= i1; ++i2) {
             ranks[2] = i2;
-            hands_[3].emplace_back(ranks.begin(), ranks.begin() + 3);
-            for (auto i3 = min_card_rank; i3 <= i2; ++i3) {
+            result[next[3]++] = Hand(ranks.begin(), ranks.begin() + 3);
+            for (Rank i3 = min_card_rank; i3 <= i2; ++i3) {
                ranks[3] = i3;
-               hands_[4].emplace_back(ranks.begin(), ranks.begin() + 4);
+               result[next[4]++] = Hand(ranks.begin(), ranks.begin() + 4);
             }
          }
       }
    }
+   return result;
+}();
+
+CardPlayHands::HandRange CardPlayHands::hands(int num_cards) noexcept
+{
+   assert(num_cards >= 0);
+   assert(num_cards <= num_cards_in_hand);
+   return HandRange(all_hands.data() + hand_offsets[num_cards],
+                    all_hands.data() + hand_offsets[num_cards + 1]);
 }
 
 CardPlayHandsIterator::CardPlayHandsIterator(int num_cards,
                                              const RankCounts& ranks_seen)
-: hands_(CardPlayHands::get().hands(num_cards)),
+: hands_(CardPlayHands::hands(num_cards)),
   ranks_seen_(ranks_seen)
 {
 
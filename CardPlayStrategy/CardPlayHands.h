@@ -11,7 +11,7 @@
 #include "Card.h"
 #include <array>
 #include <cassert>
-#include <vector>
+#include <cstdint>
 
 // Maintains a count for each rank. Enables efficient computation of how many
 // different combinations exist for a given hand.
@@ -29,12 +29,25 @@ public:
    void add_all(Rank rank) noexcept;
 
    // Add the rank to the current count.
-   RankCounts& operator +=(Rank rhs) noexcept;
-   
+   constexpr RankCounts& operator +=(Rank rhs) noexcept;
+
+   // Returns the counts packed into a single word, key_bits_per_rank bits per
+   // rank. Equal counts have equal keys.
+   uint64_t key() const noexcept;
+   static constexpr int key_bits_per_rank = 3;
+   static constexpr int key_bits = key_bits_per_rank * num_card_ranks;
+
 private:
    std::array<int, max_card_rank + 1> counts_{};
    // Pre-computed values for C'(n, k) = C(num_card_suits - n, k)
-   static const int Cprime[5][5];
+   static constexpr int Cprime[5][5] =
+   {
+      { 1, 4, 6, 4, 1 },
+      { 1, 3, 3, 1, 0 },
+      { 1, 2, 1, 0, 0 },
+      { 1, 1, 0, 0, 0 },
+      { 1, 0, 0, 0, 0 }
+   };
    // Lookup table assumes we never have more than four cards of a given rank.
    static_assert(num_card_suits <= 4);
 };
@@ -49,14 +62,25 @@ inline void RankCounts::add_all(Rank rank) noexcept
    counts_[rank] = num_card_suits;
 }
 
-inline RankCounts& RankCounts::operator +=(Rank rhs) noexcept
+inline constexpr RankCounts& RankCounts::operator +=(Rank rhs) noexcept
 {
    assert(counts_[rhs] < num_card_suits);
    ++counts_[rhs];
    return *this;
 }
 
-// Collection of all possible card play hands.
+inline uint64_t RankCounts::key() const noexcept
+{
+   static_assert(num_card_suits < (1 << key_bits_per_rank));
+   uint64_t result = 0;
+   for (auto rank = max_card_rank; rank >= min_card_rank; --rank) {
+      result = (result << key_bits_per_rank) | counts_[rank];
+   }
+   return result;
+}
+
+// Collection of all possible card play hands. The hands are generated at
+// compile time.
 class CardPlayHands
 {
 public:
@@ -65,30 +89,65 @@ public:
       RanksInHand hand;
       RankCounts counts;
 
-      Hand() = default;
-      Hand(const Rank* begin, const Rank* end) noexcept;
+      constexpr Hand() noexcept = default;
+      constexpr Hand(const Rank* begin, const Rank* end) noexcept;
    };
 
-   // Returns all possible hands made up of the given number of cards.
-   const std::vector<Hand>& hands(int num_cards) const noexcept;
+   // Read-only view of the hands made up of a given number of cards.
+   class HandRange
+   {
+   public:
+      HandRange(const Hand* begin, const Hand* end) noexcept;
 
-   // It's moderately expensive to construct one of these objects, and it's
-   // read-only after construction, so make it a singleton.
-   static const CardPlayHands& get() noexcept;
+      const Hand* begin() const noexcept;
+      const Hand* end() const noexcept;
+      size_t size() const noexcept;
+      const Hand& operator[](size_t pos) const noexcept;
 
-private:
-   CardPlayHands();
+   private:
+      const Hand* begin_;
+      const Hand* end_;
+   };
 
-   // Entries for every possible hand.
-   std::array<std::vector<Hand>, num_cards_in_hand + 1> hands_;
+   // Returns all possible hands made up of the given number of cards.
+   static HandRange hands(int num_cards) noexcept;
 };
 
-inline const std::vector<CardPlayHands::Hand>&
-CardPlayHands::hands(int num_cards) const noexcept
+inline constexpr CardPlayHands::Hand::Hand(const Rank* begin,
+                                           const Rank* end) noexcept
+{
+   for (auto rank = begin; rank != end; ++rank) {
+      hand.push_back(*rank);
+      counts += *rank;
+   }
+}
+
+inline CardPlayHands::HandRange::HandRange(const Hand* begin,
+                                           const Hand* end) noexcept
+: begin_(begin),
+  end_(end)
+{ }
+
+inline auto CardPlayHands::HandRange::begin() const noexcept -> const Hand*
+{
+   return begin_;
+}
+
+inline auto CardPlayHands::HandRange::end() const noexcept -> const Hand*
+{
+   return end_;
+}
+
+inline size_t CardPlayHands::HandRange::size() const noexcept
+{
+   return end_ - begin_;
+}
+
+inline auto CardPlayHands::HandRange::operator[](size_t pos) const noexcept
+-> const Hand&
 {
-   assert(num_cards >= 0);
-   assert(num_cards <= num_cards_in_hand);
-   return hands_[num_cards];
+   assert(pos < size());
+   return begin_[pos];
 }
 
 // Emumerates card play hands.
@@ -112,7 +171,7 @@ public:
    int rcombos() const noexcept;
 
 private:
-   const std::vector<CardPlayHands::Hand>& hands_;
+   CardPlayHands::HandRange hands_;
    RankCounts ranks_seen_;
    int pos_ = -1;
    int combos_ = 0;
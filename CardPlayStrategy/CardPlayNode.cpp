@@ -6,18 +6,14 @@
 //
 
 #include "CardPlayNode.h"
-#include <algorithm>
 
 void CardPlayNode::start_new_round(const RanksInHand& hand,
                                    bool dealer) noexcept
 {
-   // Save the observer's hand.
-   observer_.resize(hand.size());
-   std::copy(hand.begin(), hand.end(), observer_.begin());
-
-   // Resize the opponent's hand, but leave the contents alone. This will be
-   // filled in when randomize is called.
-   opponent_.resize(num_cards_in_hand);
+   // Save the observer's hand. The opponent's hand is filled in when
+   // randomize is called.
+   observer_ = pack(hand);
+   opponent_ = 0;
 
    // Reset the CardPlayGame.
    model_.start_new_round(dealer ? observer_index
@@ -29,18 +25,19 @@ void CardPlayNode::start_new_round(const RanksInHand& hand,
 void CardPlayNode::randomize(const RanksInHand& unseen) noexcept
 {
    assert(unseen.size() == unseen_card_count());
-   std::copy(unseen.begin(), unseen.end(), opponent_.begin());
+   opponent_ = pack(unseen);
 }
 
 RanksInHand CardPlayNode::valid_plays() const noexcept
 {
    RanksInHand valid;
-   for (auto rank : current_hand()) {
-      // Check for duplicates because the hand may contain multiple cards of
-      // the same rank.
-      if (model_.is_legal_play(rank) && !valid.contains(rank)) {
+   Rank rank = min_card_rank;
+   auto hand = current_hand() & legal_mask(model_.count());
+   for (; hand != 0; hand >>= bit_width) {
+      if (hand & ((1 << bit_width) - 1)) {
          valid.push_back(rank);
       }
+      ++rank;
    }
    if (valid.empty()) {
       valid.push_back(go_rank);
@@ -52,14 +49,32 @@ void CardPlayNode::make_play(Rank play, bool force) noexcept
 {
    if (play != go_rank) {
       if (force) {
+         // The opponent's counts are stale until randomize is called.
          assert(!is_current_player());
-         current_hand().pop_back();
       } else {
-         [[maybe_unused]] auto removed = current_hand().remove_first(play);
-         assert(removed);
+         assert(contains(current_hand(), play));
+         current_hand() -= count_bit(play);
       }
    }
    // Save this before making a play since that may change current player.
    int color = is_current_player() ? +1 : -1;
    result_ += model_.play_rank(play) * color;
 }
+
+CardPlayNode::PackedHand CardPlayNode::pack(const RanksInHand& hand) noexcept
+{
+   PackedHand result = 0;
+   for (auto rank : hand) {
+      result += count_bit(rank);
+   }
+   return result;
+}
+
+int CardPlayNode::size(PackedHand hand) noexcept
+{
+   auto result = 0;
+   for (; hand != 0; hand >>= bit_width) {
+      result += hand & ((1 << bit_width) - 1);
+   }
+   return result;
+}
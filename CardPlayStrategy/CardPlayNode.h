@@ -9,12 +9,48 @@
 #define CardPlayGame_h
 
 #include "CardPlayModel.h"
+#include <cstdint>
 
 // Represents a node in the card play game tree. Provides an abstraction
 // suitable for tree-search alorithms.
+//
+// Each hand is stored as a count of each rank packed into a single word, and
+// the model is only a few bytes, so nodes are cheap to copy. Search algorithms
+// can also use do_play/undo_play to update a single node in place.
 class CardPlayNode
 {
 public:
+   // Uniquely identifies the state of the game from the observer's point of
+   // view, ignoring the points scored so far. Nodes with the same key have the
+   // same future, so this is useful for detecting transpositions.
+   struct Key
+   {
+      // Observer's rank counts and the state of the series.
+      uint64_t observer;
+      // Opponent's rank counts.
+      uint64_t opponent;
+   };
+   // Number of bits used by the opponent's rank counts in the key.
+   static constexpr int opponent_key_bits = 40;
+
+   // State needed to take back a play.
+   struct Undo
+   {
+      Rank play;
+      int result;
+      CardPlayModel model;
+   };
+
+   // Hands are stored as a count of each rank packed into a single word.
+   using PackedHand = uint64_t;
+   // Returns the packed hand holding a single card of the given rank.
+   static PackedHand count_bit(Rank rank) noexcept;
+   static PackedHand pack(const RanksInHand& hand) noexcept;
+   static bool contains(PackedHand hand, Rank rank) noexcept;
+   // Returns a mask of the counts for the ranks that can be played without
+   // pushing the count over 31.
+   static PackedHand legal_mask(int count) noexcept;
+
    // Starts a new round with the specified state for the observer. You
    // must call randomize to initialize the opponent's state.
    void start_new_round(const RanksInHand& hand, bool dealer) noexcept;
@@ -26,35 +62,56 @@ public:
    bool is_current_player() const noexcept;
    // Running point count for the cards on the table.
    int count() const noexcept;
-   // Returns the set of valid moves from the current node.
+   // Returns the set of valid moves from the current node in order of
+   // increasing rank.
    RanksInHand valid_plays() const noexcept;
+   // Net points the play would score without making it.
+   int points(Rank play) const noexcept;
    // If force is true, makes the play even if the card isn't found in the
    // current hand. This is used when updating the game state based on an
    // opponent's actual play; you must then call randomize to reinitialize the
    // opponent's hand.
    void make_play(Rank play, bool force = false) noexcept;
+   // Makes the play and returns the state needed to take it back.
+   Undo do_play(Rank play) noexcept;
+   // Takes back the most recent play made by do_play.
+   void undo_play(const Undo& undo) noexcept;
    // Returns true if we're at a terminal node, i.e., the round is over.
    bool is_terminal() const noexcept;
+   // Number of cards left to play in the round.
+   int cards_left() const noexcept;
    // The cumulative net points scored when this node is reached.
    int result() const noexcept;
+   Key key() const noexcept;
    // Perform the specified play and return the new game state.
    CardPlayNode operator[](Rank play) const noexcept;
 
 private:
    static constexpr PlayerIndex observer_index = 0;
 
-   RanksInHand& current_hand() noexcept;
-   const RanksInHand& current_hand() const noexcept;
+   // Each rank has a 3-bit count, which can hold up to one card per suit.
+   static constexpr int bit_width = 3;
+   static_assert(num_card_suits < (1 << bit_width));
+   static constexpr int hand_bits = bit_width * num_card_ranks;
+   static_assert(hand_bits <= opponent_key_bits);
 
-   RanksInHand observer_;
-   RanksInHand opponent_;
+   // Returns the number of cards in a packed hand.
+   static int size(PackedHand hand) noexcept;
+
+   PackedHand& current_hand() noexcept;
+   PackedHand current_hand() const noexcept;
+
+   PackedHand observer_ = 0;
+   PackedHand opponent_ = 0;
    CardPlayModel model_;
    int result_ = 0;
 };
 
 inline int CardPlayNode::unseen_card_count() const noexcept
 {
-   return static_cast<int>(opponent_.size());
+   // Once the opponent's actual play is forced, the opponent's counts are
+   // stale, so derive the count from the number of cards played.
+   return cards_left() - size(observer_);
 }
 
 inline bool CardPlayNode::is_current_player() const noexcept
@@ -67,16 +124,51 @@ inline int CardPlayNode::count() const noexcept
    return model_.count();
 }
 
+inline int CardPlayNode::points(Rank play) const noexcept
+{
+   auto model = model_;
+   int color = is_current_player() ? +1 : -1;
+   return model.play_rank(play) * color;
+}
+
+inline CardPlayNode::Undo CardPlayNode::do_play(Rank play) noexcept
+{
+   Undo undo{ play, result_, model_ };
+   make_play(play);
+   return undo;
+}
+
+inline void CardPlayNode::undo_play(const Undo& undo) noexcept
+{
+   model_ = undo.model;
+   result_ = undo.result;
+   if (undo.play != go_rank) {
+      current_hand() += count_bit(undo.play);
+   }
+}
+
 inline bool CardPlayNode::is_terminal() const noexcept
 {
    return model_.round_over();
 }
 
+inline int CardPlayNode::cards_left() const noexcept
+{
+   return max_cards_in_play - model_.cards_played();
+}
+
 inline int CardPlayNode::result() const noexcept
 {
    return result_;
 }
 
+inline CardPlayNode::Key CardPlayNode::key() const noexcept
+{
+   uint64_t observer = model_.key();
+   observer = (observer << hand_bits) | observer_;
+   return { observer, opponent_ };
+}
+
 inline CardPlayNode CardPlayNode::operator[](Rank play) const noexcept
 {
    CardPlayNode child(*this);
@@ -84,12 +176,32 @@ inline CardPlayNode CardPlayNode::operator[](Rank play) const noexcept
    return child;
 }
 
-inline RanksInHand& CardPlayNode::current_hand() noexcept
+inline CardPlayNode::PackedHand CardPlayNode::count_bit(Rank rank) noexcept
+{
+   return PackedHand{1} << (bit_width * rank_ordinal(rank));
+}
+
+inline bool CardPlayNode::contains(PackedHand hand, Rank rank) noexcept
+{
+   return ((hand >> (bit_width * rank_ordinal(rank))) &
+           ((1 << bit_width) - 1)) != 0;
+}
+
+inline CardPlayNode::PackedHand CardPlayNode::legal_mask(int count) noexcept
+{
+   // Ranks are in order of increasing value, so the legal ranks are the
+   // low-order counts.
+   auto max_value = max_count_in_play - count;
+   auto max_rank = (max_value >= max_card_value) ? max_card_rank : max_value;
+   return (PackedHand{1} << (bit_width * rank_ordinal(max_rank + 1))) - 1;
+}
+
+inline CardPlayNode::PackedHand& CardPlayNode::current_hand() noexcept
 {
    return is_current_player() ? observer_ : opponent_;
 }
 
-inline const RanksInHand& CardPlayNode::current_hand() const noexcept
+inline CardPlayNode::PackedHand CardPlayNode::current_hand() const noexcept
 {
    return is_current_player() ? observer_ : opponent_;
 }
@@ -9,21 +9,34 @@
 #include "CardPlayHands.h"
 #include "MinimaxStrategy.h"
 #include "FileIO.h"
+#include <algorithm>
+#include <cstdio>
 #include <future>
 
+using namespace std::chrono;
+
 HandVsHand::HandVsHand()
-: table_(std::make_unique<Table>())
+: table_(std::make_unique<Table>()),
+  built_(num_hands, false)
 {
-   auto& hands = CardPlayHands::get().hands(num_cards_in_hand);
-   assert(hands.size() == num_hands);
-
-   for (auto i = 0; i < num_hands; ++i) {
-      index_[key(hands[i].hand)] = i;
-   }
+   assert(CardPlayHands::hands(num_cards_in_hand).size() == num_hands);
 }
 
 void HandVsHand::build()
 {
+   build(0, num_hands);
+}
+
+int HandVsHand::build(int first, int last, seconds budget)
+{
+   assert(first >= 0);
+   assert(last <= num_hands);
+   next_row_ = first;
+   last_row_ = last;
+   rows_built_ = 0;
+   start_ = steady_clock::now();
+   budget_ = budget;
+
    auto num_workers = std::thread::hardware_concurrency();
 
    // Launch the workers ...
@@ -31,12 +44,31 @@ void HandVsHand::build()
    for (auto i = 0; i < num_workers; ++i) {
       futures.push_back(std::async(std::launch::async,
                                    &HandVsHand::build_worker,
-                                   this,
-                                   i,
-                                   num_workers));
+                                   this));
    }
    // ... and wait for them to complete.
    std::for_each(futures.begin(), futures.end(), [](auto& f){ f.get(); });
+
+   return rows_built_;
+}
+
+int HandVsHand::num_rows_built() const noexcept
+{
+   return static_cast<int>(std::count(built_.begin(), built_.end(), true));
+}
+
+void HandVsHand::set_checkpoint(const char* filename, seconds interval)
+{
+   checkpoint_file_ = filename;
+   checkpoint_interval_ = interval;
+   last_checkpoint_ = steady_clock::now();
+}
+
+void HandVsHand::set_progress(Progress callback, seconds interval)
+{
+   progress_ = std::move(callback);
+   progress_interval_ = interval;
+   last_progress_ = steady_clock::now();
 }
 
 bool HandVsHand::load(const char* filename) noexcept
@@ -52,33 +84,163 @@ bool HandVsHand::load(const char* filename) noexcept
    if (!read_complete(istrm)) {
       return false;
    }
+   std::fill(built_.begin(), built_.end(), true);
    return true;
 }
 
 void HandVsHand::save(const char* filename) const noexcept
 {
+   assert(is_complete());
    std::ofstream ostrm(filename, std::ios::binary | std::ios::trunc);
    write_pod(ostrm, *table_);
 }
 
-void HandVsHand::build_worker(int idx, int num_workers) noexcept
+bool HandVsHand::load_partial(const char* filename)
 {
-   auto& hands = CardPlayHands::get().hands(num_cards_in_hand);
+   std::vector<uint8_t> built;
+   auto table = std::make_unique<Table>();
+   if (!read_partial(filename, built, *table)) {
+      return false;
+   }
+   built_.swap(built);
+   table_.swap(table);
+   return true;
+}
+
+void HandVsHand::save_partial(const char* filename,
+                              int first,
+                              int last) const noexcept
+{
+   assert(first >= 0);
+   assert(last <= num_hands);
+   auto built = built_;
+   std::fill(built.begin(), built.begin() + first, false);
+   std::fill(built.begin() + last, built.end(), false);
+
+   std::ofstream ostrm(filename, std::ios::binary | std::ios::trunc);
+   write_pod(ostrm, FileHeader{ file_magic, file_version });
+   write_pod_vector(ostrm, built);
+   write_pod(ostrm, *table_);
+}
 
-   // We divide the dealer hands among the workers.
-   for (auto i = idx; i < hands.size(); i += num_workers) {
-      auto& dealer = hands[i];
-      CardPlayHandsIterator pone(num_cards_in_hand, dealer.counts);
-      while (pone.next()) {
-         auto points = play_round(dealer.hand, pone.hand());
+bool HandVsHand::merge(const char* filename)
+{
+   std::vector<uint8_t> built;
+   auto table = std::make_unique<Table>();
+   if (!read_partial(filename, built, *table)) {
+      return false;
+   }
+   // Rows are deterministic, so it doesn't matter which copy of a row built
+   // in both tables is kept.
+   for (auto i = 0; i < num_hands; ++i) {
+      if (built[i] && !built_[i]) {
+         auto row = table->begin() + (num_hands * i);
+         std::copy(row, row + num_hands, (*this)[i]);
+         built_[i] = true;
+      }
+   }
+   return true;
+}
 
-         auto& cell = (*this)[i][pone.pos()];
-         cell.dealer_points = points.first;
-         cell.pone_points = points.second;
+void HandVsHand::build_worker() noexcept
+{
+   Row row;
+   while (duration_cast<seconds>(steady_clock::now() - start_) < budget_) {
+      // Take the next row that hasn't been built.
+      auto i = next_row_++;
+      if (i >= last_row_) {
+         break;
+      }
+      if (built_[i]) {
+         continue;
       }
+
+      build_row(i, row);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::copy(row.begin(), row.end(), (*this)[i]);
+      built_[i] = true;
+      ++rows_built_;
+      checkpoint();
+      report_progress();
+   }
+}
+
+void HandVsHand::build_row(int pos, Row& row) noexcept
+{
+   auto hands = CardPlayHands::hands(num_cards_in_hand);
+   auto& dealer = hands[pos];
+
+   // Pone hands that can't be dealt with the dealer's hand are left empty.
+   row.fill(Cell{ 0, 0 });
+   CardPlayHandsIterator pone(num_cards_in_hand, dealer.counts);
+   while (pone.next()) {
+      auto points = play_round(dealer.hand, pone.hand());
+
+      auto& cell = row[pone.pos()];
+      cell.dealer_points = points.first;
+      cell.pone_points = points.second;
    }
 }
 
+void HandVsHand::checkpoint()
+{
+   if (checkpoint_file_.empty()) {
+      return;
+   }
+   auto now = steady_clock::now();
+   if (duration_cast<seconds>(now - last_checkpoint_) < checkpoint_interval_) {
+      return;
+   }
+   // Write to a temporary file and rename it, so a crash during the save
+   // doesn't destroy the previous checkpoint.
+   auto tmp = checkpoint_file_ + ".tmp";
+   save_partial(tmp.c_str());
+   std::rename(tmp.c_str(), checkpoint_file_.c_str());
+   last_checkpoint_ = now;
+}
+
+void HandVsHand::report_progress()
+{
+   if (!progress_) {
+      return;
+   }
+   auto now = steady_clock::now();
+   if (duration_cast<seconds>(now - last_progress_) < progress_interval_) {
+      return;
+   }
+   progress_(num_rows_built());
+   last_progress_ = now;
+}
+
+bool HandVsHand::read_partial(const char* filename,
+                              std::vector<uint8_t>& built,
+                              Table& table)
+{
+   std::ifstream istrm(filename, std::ios::binary);
+   if (!istrm.is_open()) {
+      return false;
+   }
+   FileHeader header;
+   if (!read_pod(istrm, header)) {
+      return false;
+   }
+   if ((header.magic != file_magic) || (header.version != file_version)) {
+      return false;
+   }
+   if (!read_pod_vector(istrm, built) || (built.size() != num_hands)) {
+      return false;
+   }
+   // Can't use read_pod since it uses a stack-allocated buffer.
+   if (!istrm.read(reinterpret_cast<char*>(&table), sizeof(table))) {
+      return false;
+   }
+   if (!read_complete(istrm)) {
+      return false;
+   }
+   return true;
+}
+
 std::pair<int, int> HandVsHand::play_round(const RanksInHand& dealer,
                                            const RanksInHand& pone) noexcept
 {
@@ -100,21 +262,3 @@ std::pair<int, int> HandVsHand::play_round(const RanksInHand& dealer,
 
    return { points[0], points[1] };
 }
-
-HandVsHand::KeyType HandVsHand::key(const CardsKept& hand) noexcept
-{
-   UnorderedRanksKey key;
-   std::for_each(hand.begin(), hand.end(), [&key](auto card) {
-      key.insert(card.rank());
-   });
-   return key();
-}
-
-HandVsHand::KeyType HandVsHand::key(const RanksInHand& hand) noexcept
-{
-   UnorderedRanksKey key;
-   std::for_each(hand.begin(), hand.end(), [&key](auto rank) {
-      key.insert(rank);
-   });
-   return key();
-}
@@ -10,10 +10,17 @@
 
 #include "Card.h"
 #include "RankKeys.h"
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
 #include <cstdint>
+#include <functional>
 #include <memory>
-#include <unordered_map>
+#include <mutex>
+#include <string>
+#include <vector>
 
 // Maintains a table of results for every possible combination of dealer and
 // pone hands.
@@ -25,6 +32,16 @@ public:
       uint8_t pone_points;
    };
 
+   // These assumptions make the combinations calculation easier.
+   static_assert(num_card_ranks == 13);
+   static_assert(num_cards_in_hand == 4);
+   static_assert(num_card_suits >= num_cards_in_hand);
+
+   // Number of k-element combos of n objects with repetition is C(n+k+1, k).
+   // This is the number of rows and columns in the table; each row holds the
+   // results for one dealer hand.
+   static constexpr int num_hands = (16 * 15 * 14 * 13)/(4 * 3 * 2 * 1);
+
    HandVsHand();
    HandVsHand(HandVsHand&) = delete;
    HandVsHand& operator=(HandVsHand&) = delete;
@@ -33,47 +50,108 @@ public:
    Cell* operator[](int pos) noexcept;
    const Cell* operator[](int pos) const noexcept;
 
-   // Look up the ordinal in the table for a given hand.
-   int ordinal(const CardsKept& hand) const noexcept;
-   int ordinal(const RanksInHand& hand) const noexcept;
+   // Returns the ordinal in the table for a given hand. Hands are ordered as
+   // in CardPlayHands, which is the colexicographic order computed by
+   // UnorderedRanksIndex, so the ordinal is computed directly.
+   static int ordinal(const CardsKept& hand) noexcept;
+   static int ordinal(const RanksInHand& hand) noexcept;
 
    // Build the table.
    void build();
-
-   // Load/save the data from/to a file.
+   // Builds the rows in [first, last) that haven't been built yet. Rows are
+   // handed out to the workers one at a time, so the build isn't held up by a
+   // worker stuck with the expensive rows. Stops early once the budget runs
+   // out. Returns the number of rows built.
+   int build(int first,
+             int last,
+             std::chrono::seconds budget = std::chrono::seconds::max());
+
+   // Returns the number of rows that have been built, including any rows
+   // loaded or merged from a file.
+   int num_rows_built() const noexcept;
+   bool is_complete() const noexcept;
+
+   // While building, periodically save the partial table to the given file,
+   // so an interrupted build can be resumed with load_partial().
+   void set_checkpoint(const char* filename, std::chrono::seconds interval);
+   // While building, periodically invoke the callback with the number of rows
+   // built so far. The callback is invoked from the worker threads, but never
+   // from more than one at a time.
+   using Progress = std::function<void(int rows_built)>;
+   void set_progress(Progress callback, std::chrono::seconds interval);
+
+   // Load/save the complete table from/to a file.
    bool load(const char* filename) noexcept;
    void save(const char* filename) const noexcept;
+   // Load/save a partially built table along with the rows that are built.
+   // If a range is given, only the rows built in [first, last) are saved.
+   bool load_partial(const char* filename);
+   void save_partial(const char* filename,
+                     int first = 0,
+                     int last = num_hands) const noexcept;
+   // Adds the rows built in a partial table file. This allows a build to be
+   // split across independent processes and combined.
+   bool merge(const char* filename);
 
 private:
+   // Table of outcomes. We store it as a one-dimensional array, but
+   // conceptually it's a two-dimensional array.
+   using Table = std::array<Cell, num_hands * num_hands>;
+   using Row = std::array<Cell, num_hands>;
+
+   // Header for partial table files.
+   struct FileHeader {
+      uint32_t magic;
+      uint32_t version;
+   };
+   static constexpr uint32_t file_magic = 0x50485648; // "HVHP"
+   static constexpr uint32_t file_version = 1;
+
    // Worker function for each thread.
-   void build_worker(int idx, int num_workers) noexcept;
+   void build_worker() noexcept;
+   // Computes the results for a single dealer hand.
+   static void build_row(int pos, Row& row) noexcept;
+
+   // Saves a checkpoint if one is due. Must be called with mutex_ held.
+   void checkpoint();
+   // Reports progress if it's due. Must be called with mutex_ held.
+   void report_progress();
+
+   // Reads a partial table file.
+   static bool read_partial(const char* filename,
+                            std::vector<uint8_t>& built,
+                            Table& table);
 
    // Play a round between the hands and return the number of points scored by
    // dealer and pone.
    static std::pair<int, int> play_round(const RanksInHand& dealer,
                                          const RanksInHand& pone) noexcept;
 
-   // These assumptions make the combinations calculation easier.
-   static_assert(num_card_ranks == 13);
-   static_assert(num_cards_in_hand == 4);
-   static_assert(num_card_suits >= num_cards_in_hand);
-
-   // Number of k-element combos of n objects with repetition is C(n+k+1, k)
-   static constexpr int num_hands = (16 * 15 * 14 * 13)/(4 * 3 * 2 * 1);
-
-   // Table of outcomes. We store it as a one-dimensional array, but
-   // conceptually it's a two-dimensional array. The array is dynamically
-   // allocated, so that HandVsHand can be allocated on the stack if desired.
-   using Table = std::array<Cell, num_hands * num_hands>;
+   // The table is dynamically allocated, so that HandVsHand can be allocated
+   // on the stack if desired.
    std::unique_ptr<Table> table_;
-
-   // Index mapping hands to their ordinal in the table.
-   using KeyType = UnorderedRanksKey::KeyType;
-   std::unordered_map<KeyType, int> index_;
-
-   // Helper function to compute the UnorderedRanksKey for a hand.
-   static KeyType key(const CardsKept& hand) noexcept;
-   static KeyType key(const RanksInHand& hand) noexcept;
+   // One flag per row set once the row has been built.
+   std::vector<uint8_t> built_;
+
+   // State shared by the workers during a build. Workers only write to the
+   // table and flags while holding the mutex, so a checkpoint always sees
+   // complete rows.
+   std::mutex mutex_;
+   std::atomic<int> next_row_{0};
+   int last_row_ = 0;
+   int rows_built_ = 0;
+   std::chrono::steady_clock::time_point start_;
+   std::chrono::seconds budget_{0};
+
+   // Checkpoint file or empty if checkpoints are disabled.
+   std::string checkpoint_file_;
+   std::chrono::seconds checkpoint_interval_{0};
+   std::chrono::steady_clock::time_point last_checkpoint_;
+
+   // Progress callback or empty if progress isn't reported.
+   Progress progress_;
+   std::chrono::seconds progress_interval_{0};
+   std::chrono::steady_clock::time_point last_progress_;
 };
 
 inline HandVsHand::Cell* HandVsHand::operator[](int pos) noexcept
@@ -86,18 +164,28 @@ inline const HandVsHand::Cell* HandVsHand::operator[](int pos) const noexcept
    return table_->begin() + (num_hands * pos);
 }
 
-inline int HandVsHand::ordinal(const CardsKept& hand) const noexcept
+inline int HandVsHand::ordinal(const CardsKept& hand) noexcept
+{
+   UnorderedRanksIndex index;
+   std::for_each(hand.begin(), hand.end(), [&index](auto card) {
+      index.insert(card.rank());
+   });
+   return index();
+}
+
+inline int HandVsHand::ordinal(const RanksInHand& hand) noexcept
 {
-   auto i = index_.find(key(hand));
-   assert(i != index_.end());
-   return i->second;
+   assert(hand.size() == num_cards_in_hand);
+   UnorderedRanksIndex index;
+   std::for_each(hand.begin(), hand.end(), [&index](auto rank) {
+      index.insert(rank);
+   });
+   return index();
 }
 
-inline int HandVsHand::ordinal(const RanksInHand& hand) const noexcept
+inline bool HandVsHand::is_complete() const noexcept
 {
-   auto i = index_.find(key(hand));
-   assert(i != index_.end());
-   return i->second;
+   return num_rows_built() == num_hands;
 }
 
 #endif /* HandVsHand_h */
@@ -7,33 +7,152 @@
 
 #include "MinimaxStrategy.h"
 #include "SizedArray.h"
+#include "TranspositionTable.h"
 #include <algorithm>
-#include <limits>
+#include <future>
+#include <random>
+#include <thread>
 
-int minimax(const CardPlayNode& node)
+using namespace std::chrono_literals;
+
+namespace {
+
+// Larger than the net points that can be scored during card play.
+constexpr int infinity = 1000;
+
+// Near the leaves, searching a node is cheaper than a table lookup that will
+// likely miss the cache.
+constexpr int min_cards_for_lookup = 5;
+
+// Node values don't depend on how the node was reached, so they can be shared
+// across searches. Each thread gets its own table, so no locking is needed.
+TranspositionTable& transpositions()
+{
+   thread_local TranspositionTable table;
+   return table;
+}
+
+struct Child
+{
+   // Net points scored by the play leading to this child.
+   int points;
+   Rank play;
+};
+
+} // namespace
+
+int alpha_beta(TranspositionTable& table,
+               CardPlayNode& node,
+               int alpha,
+               int beta) noexcept
 {
    if (node.is_terminal()) {
-      return node.result();
+      return 0;
+   }
+
+   using Bound = TranspositionTable::Bound;
+   const auto lookup = (node.cards_left() >= min_cards_for_lookup);
+   const auto key = node.key();
+   auto entry = lookup ? table.find(key) : TranspositionTable::Entry{};
+   switch (entry.bound) {
+      case Bound::none:
+         break;
+      case Bound::exact:
+         return entry.value;
+      case Bound::lower:
+         alpha = std::max<int>(alpha, entry.value);
+         break;
+      case Bound::upper:
+         beta = std::min<int>(beta, entry.value);
+         break;
    }
-   int value;
-   if (node.is_current_player()) {
-      value = std::numeric_limits<int>::min();
-      for (auto play : node.valid_plays()) {
-         value = std::max(value, minimax(node[play]));
+   if (alpha >= beta) {
+      return entry.value;
+   }
+
+   auto maximize = node.is_current_player();
+   SizedArray<Child, num_cards_in_hand> children;
+   for (auto play : node.valid_plays()) {
+      children.push_back({ node.points(play), play });
+   }
+   // Plays that score immediately are most likely to cause a cutoff, so
+   // search them first. There are at most four children, so an insertion
+   // sort is all that's needed.
+   for (auto i = 1; i < children.size(); ++i) {
+      auto child = children[i];
+      auto j = i;
+      for (; j > 0; --j) {
+         auto points = children[j - 1].points;
+         if (maximize ? (child.points <= points) : (child.points >= points)) {
+            break;
+         }
+         children[j] = children[j - 1];
       }
-   } else {
-      value = std::numeric_limits<int>::max();
-      for (auto play : node.valid_plays()) {
-         value = std::min(value, minimax(node[play]));
+      children[j] = child;
+   }
+
+   const auto alpha_orig = alpha;
+   const auto beta_orig = beta;
+   auto value = maximize ? -infinity : infinity;
+   for (const auto& child : children) {
+      auto undo = node.do_play(child.play);
+      auto child_value = child.points + alpha_beta(table,
+                                                   node,
+                                                   alpha - child.points,
+                                                   beta - child.points);
+      node.undo_play(undo);
+      if (maximize) {
+         value = std::max(value, child_value);
+         alpha = std::max(alpha, value);
+      } else {
+         value = std::min(value, child_value);
+         beta = std::min(beta, value);
+      }
+      if (alpha >= beta) {
+         break;
       }
    }
+
+   auto bound = Bound::exact;
+   if (value <= alpha_orig) {
+      bound = Bound::upper;
+   } else if (value >= beta_orig) {
+      bound = Bound::lower;
+   }
+   if (lookup) {
+      table.insert(key, value, bound);
+   }
    return value;
 }
 
+namespace {
+
+// Returns the cumulative net points scored by the end of the round assuming
+// both players play perfectly.
+int minimax(CardPlayNode node) noexcept
+{
+   return node.result() + alpha_beta(transpositions(),
+                                     node,
+                                     -infinity,
+                                     infinity);
+}
+
+} // namespace
+
+MinimaxStrategy::MinimaxStrategy(bool parallel, const Budget& budget) noexcept
+: num_workers_(parallel ? std::max(std::thread::hardware_concurrency(), 1u)
+                      : 1),
+  budget_(budget),
+  rng_(pcg_extras::seed_seq_from<std::random_device>())
+{ }
+
 void MinimaxStrategy::start_new_round(const RanksInHand& hand,
                                          bool dealer) noexcept
 {
    game_.start_new_round(hand, dealer);
+   dealer_ = dealer;
+   hand_ = hand;
+   others_.clear();
 
    ranks_seen_.clear();
    std::for_each(hand.begin(), hand.end(), [this](auto rank) {
@@ -76,16 +195,194 @@ Rank MinimaxStrategy::solve() noexcept
    if (plays.size() == 1) {
       return plays[0];
    }
-   
-   SizedArray<int, num_cards_in_hand> results(plays.size());
+
+   if (book_ && (game_.cards_left() == max_cards_in_play)) {
+      auto lead = book_->find(hand_, others_);
+      if (lead != go_rank) {
+         assert(plays.contains(lead));
+         return lead;
+      }
+   }
+
+   const auto cacheable = cache_ && budget_.is_unlimited();
+   SolveCache::Key key{};
+   if (cacheable) {
+      key = cache_key();
+      auto play = cache_->find(key);
+      if (play != go_rank) {
+         assert(plays.contains(play));
+         return play;
+      }
+   }
+
+   const auto start = Clock::now();
+   hands_.clear();
    CardPlayHandsIterator hands(game_.unseen_card_count(), ranks_seen_);
    while (hands.next()) {
-      game_.randomize(hands.hand());
-      for (auto j = 0; j < plays.size(); ++j) {
-         results[j] += minimax(game_[plays[j]]) * hands.combos();
+      hands_.push_back({ hands.hand(), hands.combos() });
+   }
+
+   Results results(plays.size());
+   if (budget_.is_unlimited()) {
+      search(hands_.data(),
+             hands_.data() + hands_.size(),
+             plays,
+             Clock::time_point::max(),
+             results);
+   } else {
+      // Shuffle first, so that equally likely hands are searched in a random
+      // order.
+      std::shuffle(hands_.begin(), hands_.end(), rng_);
+      std::stable_sort(hands_.begin(),
+                       hands_.end(),
+                       [](const auto& lhs, const auto& rhs) {
+         return lhs.combos > rhs.combos;
+      });
+
+      auto deadline = Clock::time_point::max();
+      if (budget_.time != std::chrono::microseconds::max()) {
+         deadline = start + budget_.time;
+      }
+      auto num_hands = std::min<int>(budget_.max_hands, hands_.size());
+      auto num_searched = 0;
+      // Don't start searching if the budget is already spent.
+      auto batch = (start < deadline) ? std::min(first_batch_size, num_hands)
+                                      : 0;
+      while (batch > 0) {
+         auto first = hands_.data() + num_searched;
+         if (!search(first, first + batch, plays, deadline, results)) {
+            break;
+         }
+         num_searched += batch;
+
+         // Larger batches are more efficient, but don't start a batch that
+         // is unlikely to finish before the deadline.
+         auto now = Clock::now();
+         if (now >= deadline) {
+            break;
+         }
+         auto time_per_hand = (now - start) / num_searched;
+         auto affordable = (deadline - now) / (time_per_hand + 1us);
+         batch = std::min<int64_t>({ 2 * batch,
+                                     affordable,
+                                     num_hands - num_searched });
+      }
+
+      if (num_searched == 0) {
+         // Ran out of time before any hand was searched, so fall back to the
+         // play that scores the most points right away.
+         for (auto j = 0; j < plays.size(); ++j) {
+            results[j] = game_.points(plays[j]);
+         }
       }
    }
 
    auto i = std::max_element(results.begin(), results.end());
-   return plays[std::distance(results.begin(), i)];
+   auto play = plays[std::distance(results.begin(), i)];
+   if (cacheable) {
+      cache_->insert(key, play);
+   }
+   return play;
+}
+
+SolveCache::Key MinimaxStrategy::cache_key() const noexcept
+{
+   // The observer's half of the node key covers our own hand and the series.
+   // The opponent's possible hands follow from the ranks seen and the number
+   // of cards they have left.
+   auto seen = ranks_seen_.key();
+   seen = (seen << 3) | game_.unseen_card_count();
+   seen = (seen << 1) | dealer_;
+   return { game_.key().observer, seen };
+}
+
+bool MinimaxStrategy::search(const Hypothesis* first,
+                             const Hypothesis* last,
+                             const RanksInHand& plays,
+                             Clock::time_point deadline,
+                             Results& results)
+{
+   auto num_hands = static_cast<int>(last - first);
+   auto num_workers = std::min(num_workers_, num_hands);
+
+   // Only the single-walk search can be abandoned at the deadline.
+   const auto timed = (deadline != Clock::time_point::max());
+   Results batch(plays.size(), 0);
+   if (num_workers > 1) {
+      if (tables_.size() < num_workers) {
+         tables_.resize(num_workers);
+      }
+      // Launch the workers ...
+      std::vector<Results> worker_results(num_workers);
+      std::vector<std::future<bool>> futures;
+      for (auto i = 0; i < num_workers; ++i) {
+         futures.push_back(std::async(std::launch::async,
+                                      &MinimaxStrategy::search_worker,
+                                      this,
+                                      first,
+                                      last,
+                                      std::cref(plays),
+                                      deadline,
+                                      i,
+                                      num_workers,
+                                      std::ref(worker_results[i])));
+      }
+      // ... and wait for them to complete.
+      auto completed = true;
+      std::for_each(futures.begin(), futures.end(), [&](auto& f) {
+         completed = f.get() && completed;
+      });
+      if (!completed) {
+         return false;
+      }
+
+      // The results are integer sums over the hands, so they don't depend on
+      // how the hands are split between the workers.
+      for (const auto& worker : worker_results) {
+         for (auto j = 0; j < plays.size(); ++j) {
+            batch[j] += worker[j];
+         }
+      }
+   } else if ((num_hands > 1) || timed) {
+      // Searching all the hands in one walk of the tree shares the work of the
+      // observer's moves across hands.
+      belief_.clear();
+      std::for_each(first, last, [this](const auto& h) {
+         belief_.add_hand(h.hand, h.combos);
+      });
+      belief_.set_deadline(deadline);
+      batch = belief_.solve(transpositions(), game_, plays);
+      if (belief_.timed_out()) {
+         return false;
+      }
+   } else if (num_hands == 1) {
+      // With only one hand, there's nothing to share, but alpha-beta can
+      // prune.
+      game_.randomize(first->hand);
+      for (auto j = 0; j < plays.size(); ++j) {
+         batch[j] = minimax(game_[plays[j]]) * first->combos;
+      }
+   }
+
+   for (auto j = 0; j < plays.size(); ++j) {
+      results[j] += batch[j];
+   }
+   return true;
+}
+
+bool MinimaxStrategy::search_worker(const Hypothesis* first,
+                                    const Hypothesis* last,
+                                    const RanksInHand& plays,
+                                    Clock::time_point deadline,
+                                    int worker,
+                                    int num_workers,
+                                    Results& results)
+{
+   BeliefMinimax belief;
+   for (auto i = worker; i < (last - first); i += num_workers) {
+      belief.add_hand(first[i].hand, first[i].combos);
+   }
+   belief.set_deadline(deadline);
+   results = belief.solve(tables_[worker], game_, plays);
+   return !belief.timed_out();
 }
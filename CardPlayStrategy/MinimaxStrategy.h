@@ -8,13 +8,61 @@
 #ifndef ExpectimaxStrategy_h
 #define ExpectimaxStrategy_h
 
+#include "BeliefMinimax.h"
 #include "CardPlayHands.h"
 #include "CardPlayNode.h"
+#include "OpeningBook.h"
+#include "SolveCache.h"
+#include "TranspositionTable.h"
+#include <chrono>
+#include <climits>
+#include <vector>
+#include "pcg_random.hpp"
+
+// Returns the net points the observer scores from the node to the end of the
+// round assuming both players play perfectly. If the value is outside
+// (alpha, beta), the return value is only a bound. The node is updated in
+// place, but is restored before returning.
+int alpha_beta(TranspositionTable& table,
+               CardPlayNode& node,
+               int alpha,
+               int beta) noexcept;
 
 // Implements the expectimax algorithm to select a card to play.
 class MinimaxStrategy
 {
 public:
+   // Limits the work done for each decision. Once a limit is reached, the play
+   // is chosen based on the opponent hands searched so far. Hands are searched
+   // in order of decreasing combos, so the most likely hands are covered first.
+   struct Budget
+   {
+      // Maximum wall clock time per decision ...
+      std::chrono::microseconds time = std::chrono::microseconds::max();
+      // ... and maximum number of opponent hands searched per decision.
+      int max_hands = INT_MAX;
+
+      bool is_unlimited() const noexcept;
+   };
+
+   // If parallel is true, each decision is split across all available
+   // threads. This lowers the latency of a single game, but shouldn't be used
+   // when games are already being played in parallel.
+   explicit MinimaxStrategy(bool parallel = false) noexcept;
+   MinimaxStrategy(bool parallel, const Budget& budget) noexcept;
+
+   // Overrides the number of threads each decision is split across. The
+   // results don't depend on the number of threads.
+   void set_num_workers(int num_workers) noexcept;
+
+   // If set, the pone's lead is looked up in the book instead of searched.
+   // The book must outlive the strategy.
+   void set_opening_book(const OpeningBook* book) noexcept;
+   // If set, decisions are looked up in the cache before being searched. Only
+   // decisions made without a budget are cached, since they're the only ones
+   // that always choose the same play. The cache must outlive the strategy.
+   void set_solve_cache(SolveCache* cache) noexcept;
+
    // Prepare to play a new round.
    void start_new_round(const RanksInHand& hand, bool dealer) noexcept;
 
@@ -28,19 +76,96 @@ public:
    void on_opponent_play(Rank rank) noexcept;
 
 private:
+   // A possible opponent hand and its weight.
+   struct Hypothesis
+   {
+      RanksInHand hand;
+      int combos;
+   };
+   using Results = BeliefMinimax::Results;
+   using Clock = BeliefMinimax::Clock;
+
+   // Number of hands in the first batch searched with a budget. Later batches
+   // double in size as long as they're likely to finish in time.
+   static constexpr int first_batch_size = 32;
+
    // Our current node in the game tree.
    CardPlayNode game_;
    // Count of all ranks that are accounted for, i.e., these ranks can't be in
    // the opponent's hand.
    RankCounts ranks_seen_;
+   // Searches all the opponent's possible hands at once.
+   BeliefMinimax belief_;
+   int num_workers_;
+   // Transposition table for each worker when solving in parallel.
+   std::vector<TranspositionTable> tables_;
+   Budget budget_;
+   // Possible opponent hands for the current decision.
+   std::vector<Hypothesis> hands_;
+   // Breaks ties between equally likely hands when searching with a budget.
+   pcg32 rng_;
+   const OpeningBook* book_ = nullptr;
+   // Our hand at the start of the round and the other ranks seen before the
+   // first play. Used to look up the lead in the book.
+   RanksInHand hand_;
+   RanksInHand others_;
+   SolveCache* cache_ = nullptr;
+   bool dealer_ = false;
 
    // Solve for the next move.
    Rank solve() noexcept;
+   // Returns the key identifying the current decision in the solve cache.
+   SolveCache::Key cache_key() const noexcept;
+   // Adds the weighted results of each play vs. the hands to results. Returns
+   // false, leaving results unchanged, if the deadline passes first.
+   bool search(const Hypothesis* first,
+               const Hypothesis* last,
+               const RanksInHand& plays,
+               Clock::time_point deadline,
+               Results& results);
+   // Worker function for each thread. Each worker searches the hands whose
+   // offset is congruent to worker modulo num_workers.
+   bool search_worker(const Hypothesis* first,
+                      const Hypothesis* last,
+                      const RanksInHand& plays,
+                      Clock::time_point deadline,
+                      int worker,
+                      int num_workers,
+                      Results& results);
 };
 
+inline MinimaxStrategy::MinimaxStrategy(bool parallel) noexcept
+: MinimaxStrategy(parallel, Budget())
+{ }
+
+inline void MinimaxStrategy::set_num_workers(int num_workers) noexcept
+{
+   assert(num_workers > 0);
+   num_workers_ = num_workers;
+}
+
+inline void MinimaxStrategy::set_opening_book(const OpeningBook* book) noexcept
+{
+   book_ = book;
+}
+
+inline void MinimaxStrategy::set_solve_cache(SolveCache* cache) noexcept
+{
+   cache_ = cache;
+}
+
+inline bool MinimaxStrategy::Budget::is_unlimited() const noexcept
+{
+   return (time == std::chrono::microseconds::max()) && (max_hands == INT_MAX);
+}
+
 inline void MinimaxStrategy::on_rank_seen(Rank rank) noexcept
 {
    ranks_seen_ += rank;
+   // If there are too many, the position won't be found in the book.
+   if (others_.size() < others_.capacity()) {
+      others_.push_back(rank);
+   }
 }
 
 #endif /* MinimaxSolver_h */
@@ -0,0 +1,128 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#include "OpeningBook.h"
+#include "CardPlayHands.h"
+#include "FileIO.h"
+#include "MinimaxStrategy.h"
+#include "RankKeys.h"
+#include <future>
+#include <thread>
+
+OpeningBook::OpeningBook()
+: leads_(num_hands * num_others, go_rank)
+{ }
+
+Rank OpeningBook::find(const RanksInHand& hand,
+                       const RanksInHand& others) const noexcept
+{
+   auto i = index(hand, others);
+   return (i >= 0) ? leads_[i] : go_rank;
+}
+
+void OpeningBook::build()
+{
+   build(0, num_hands);
+}
+
+void OpeningBook::build(int first, int last)
+{
+   assert((first >= 0) && (first <= last) && (last <= num_hands));
+   auto num_workers = std::thread::hardware_concurrency();
+
+   // Launch the workers ...
+   std::vector<std::future<void>> futures;
+   for (auto i = 0; i < num_workers; ++i) {
+      futures.push_back(std::async(std::launch::async,
+                                   &OpeningBook::build_worker,
+                                   this,
+                                   first,
+                                   last,
+                                   i,
+                                   num_workers));
+   }
+   // ... and wait for them to complete.
+   std::for_each(futures.begin(), futures.end(), [](auto& f){ f.get(); });
+}
+
+bool OpeningBook::load(const char* filename)
+{
+   std::ifstream istrm(filename, std::ios::binary);
+   if (!istrm.is_open()) {
+      return false;
+   }
+   uint32_t magic, version;
+   if (!read_pod(istrm, magic) || (magic != file_magic)) {
+      return false;
+   }
+   if (!read_pod(istrm, version) || (version != file_version)) {
+      return false;
+   }
+   std::vector<Rank> leads;
+   if (!read_pod_vector(istrm, leads) || (leads.size() != leads_.size())) {
+      return false;
+   }
+   if (!read_complete(istrm)) {
+      return false;
+   }
+   leads_.swap(leads);
+   return true;
+}
+
+void OpeningBook::save(const char* filename) const noexcept
+{
+   std::ofstream ostrm(filename, std::ios::binary | std::ios::trunc);
+   write_pod(ostrm, file_magic);
+   write_pod(ostrm, file_version);
+   write_pod_vector(ostrm, leads_);
+}
+
+void OpeningBook::build_worker(int first,
+                               int last,
+                               int idx,
+                               int num_workers) noexcept
+{
+   auto hands = CardPlayHands::hands(num_cards_in_hand);
+   auto others = CardPlayHands::hands(num_others_seen);
+   assert((hands.size() == num_hands) && (others.size() == num_others));
+
+   // We divide the pone hands among the workers.
+   MinimaxStrategy strategy;
+   for (auto i = first + idx; i < last; i += num_workers) {
+      for (auto j = 0; j < others.size(); ++j) {
+         // Skip positions with more cards of a rank than there are suits.
+         if (hands[i].counts.remaining_combos(others[j].counts) == 0) {
+            continue;
+         }
+         strategy.start_new_round(hands[i].hand, false);
+         for (auto rank : others[j].hand) {
+            strategy.on_rank_seen(rank);
+         }
+         leads_[index(hands[i].hand, others[j].hand)] =
+            strategy.get_rank_to_play();
+      }
+   }
+}
+
+int OpeningBook::index(const RanksInHand& hand,
+                       const RanksInHand& others) noexcept
+{
+   if ((hand.size() != num_cards_in_hand) ||
+       (others.size() != num_others_seen)) {
+      return -1;
+   }
+   UnorderedRanksIndex hand_index, others_index;
+   std::for_each(hand.begin(), hand.end(), [&hand_index](auto rank) {
+      hand_index.insert(rank);
+   });
+   std::for_each(others.begin(), others.end(), [&others_index](auto rank) {
+      others_index.insert(rank);
+   });
+   assert(hand_index() < num_hands);
+   assert(others_index() < num_others);
+   return (hand_index() * num_others) + others_index();
+}
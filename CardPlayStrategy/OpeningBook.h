@@ -0,0 +1,58 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#ifndef OpeningBook_h
+#define OpeningBook_h
+
+#include "Card.h"
+#include <vector>
+
+// Precomputed best lead for every pone hand. The lead is by far the most
+// expensive card play decision since the whole round is still ahead, and the
+// only other information available is the other ranks seen, i.e., the two
+// cards discarded to the crib and the starter.
+class OpeningBook
+{
+public:
+   // Number of ranks seen by the pone besides their own hand.
+   static constexpr int num_others_seen = num_cards_discarded_per_player + 1;
+   // Number of multisets of ranks of each size.
+   static constexpr int num_hands = 1820;
+   static constexpr int num_others = 455;
+
+   OpeningBook();
+
+   // Returns the best lead or go_rank if the position isn't in the book.
+   Rank find(const RanksInHand& hand, const RanksInHand& others) const noexcept;
+
+   // Returns the position of the entry in [0, num_hands * num_others) or -1 if
+   // the position isn't in the book. The order of the ranks doesn't matter.
+   static int index(const RanksInHand& hand,
+                    const RanksInHand& others) noexcept;
+
+   // Build the book by searching every position.
+   void build();
+   // Builds only the positions for the pone hands in [first, last), numbered
+   // in CardPlayHands order.
+   void build(int first, int last);
+
+   // Load/save the data from/to a file.
+   bool load(const char* filename);
+   void save(const char* filename) const noexcept;
+
+private:
+   // Worker function for each thread.
+   void build_worker(int first, int last, int idx, int num_workers) noexcept;
+
+   static constexpr uint32_t file_magic = 0x4b4f4f42; // "BOOK"
+   static constexpr uint32_t file_version = 1;
+
+   // Best lead for each position, or go_rank if the position is impossible.
+   std::vector<Rank> leads_;
+};
+
+#endif /* OpeningBook_h */
@@ -0,0 +1,118 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#ifndef SolveCache_h
+#define SolveCache_h
+
+#include "Card.h"
+#include "Spinlock.h"
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// Caches the play chosen for each card play decision, so the same decision
+// isn't solved again in later rounds or games. The cache may be shared by
+// players on different threads. Like the transposition table, it's direct-
+// mapped and a new entry always replaces the old one.
+class SolveCache
+{
+public:
+   // Uniquely identifies what the player knows when making the decision.
+   struct Key
+   {
+      // Player's rank counts and the state of the series.
+      uint64_t observer;
+      // Everything known about the opponent's hand.
+      uint64_t seen;
+   };
+
+   struct Stats
+   {
+      int64_t lookups;
+      int64_t hits;
+
+      double hit_rate() const noexcept;
+   };
+
+   explicit SolveCache(int log2_size = 20);
+   SolveCache(SolveCache&) = delete;
+   SolveCache& operator=(SolveCache&) = delete;
+
+   // Returns go_rank if the key isn't present.
+   Rank find(const Key& key) noexcept;
+   void insert(const Key& key, Rank play) noexcept;
+
+   Stats stats() const noexcept;
+
+private:
+   // The play is packed into the unused high bits of the seen word.
+   static constexpr int play_shift = 56;
+   static constexpr uint64_t key_mask = (uint64_t{1} << play_shift) - 1;
+   // Each lock guards every num_locks'th slot.
+   static constexpr int num_locks = 64;
+
+   size_t slot(const Key& key) const noexcept;
+
+   std::vector<Key> slots_;
+   std::array<Spinlock, num_locks> locks_;
+   int shift_;
+   std::atomic<int64_t> lookups_{0};
+   std::atomic<int64_t> hits_{0};
+};
+
+inline double SolveCache::Stats::hit_rate() const noexcept
+{
+   return (lookups > 0) ? static_cast<double>(hits) / lookups : 0.0;
+}
+
+inline SolveCache::SolveCache(int log2_size)
+: slots_(size_t{1} << log2_size, Key{ 0, 0 }),
+  shift_(64 - log2_size)
+{ }
+
+inline Rank SolveCache::find(const Key& key) noexcept
+{
+   assert((key.seen & ~key_mask) == 0);
+   lookups_.fetch_add(1, std::memory_order_relaxed);
+   auto pos = slot(key);
+   Key entry;
+   {
+      SpinlockGuard guard(locks_[pos % num_locks]);
+      entry = slots_[pos];
+   }
+   if ((entry.observer != key.observer) ||
+       ((entry.seen & key_mask) != key.seen)) {
+      return go_rank;
+   }
+   hits_.fetch_add(1, std::memory_order_relaxed);
+   return static_cast<Rank>(entry.seen >> play_shift);
+}
+
+inline void SolveCache::insert(const Key& key, Rank play) noexcept
+{
+   assert((key.seen & ~key_mask) == 0);
+   assert(play != go_rank);
+   auto pos = slot(key);
+   auto seen = key.seen | (static_cast<uint64_t>(play) << play_shift);
+   SpinlockGuard guard(locks_[pos % num_locks]);
+   slots_[pos] = { key.observer, seen };
+}
+
+inline SolveCache::Stats SolveCache::stats() const noexcept
+{
+   return { lookups_.load(), hits_.load() };
+}
+
+inline size_t SolveCache::slot(const Key& key) const noexcept
+{
+   auto hash = key.observer ^ (key.seen * 0xff51afd7ed558ccdull);
+   return static_cast<size_t>((hash * 0x9e3779b97f4a7c15ull) >> shift_);
+}
+
+#endif /* SolveCache_h */
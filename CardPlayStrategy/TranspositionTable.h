@@ -0,0 +1,97 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#ifndef TranspositionTable_h
+#define TranspositionTable_h
+
+#include "CardPlayNode.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// Caches the values of card play nodes that have already been searched. Many
+// lines of play transpose, so this avoids searching the same subtree twice.
+// The table is direct-mapped and a new entry always replaces the old one.
+class TranspositionTable
+{
+public:
+   using Key = CardPlayNode::Key;
+
+   // Alpha-beta search may only establish a bound on a node's value.
+   enum class Bound : uint8_t { none, exact, lower, upper };
+
+   struct Entry
+   {
+      int value;
+      Bound bound;
+   };
+
+   explicit TranspositionTable(int log2_size = 20);
+
+   // Returns an entry with Bound::none if the key isn't present.
+   Entry find(const Key& key) const noexcept;
+   void insert(const Key& key, int value, Bound bound) noexcept;
+   void clear() noexcept;
+
+private:
+   // The value and bound are packed into the unused bits of the opponent's
+   // half of the key, so each slot is only two words.
+   static constexpr int bound_shift = CardPlayNode::opponent_key_bits;
+   static constexpr int value_shift = bound_shift + 8;
+   static constexpr uint64_t key_mask = (uint64_t{1} << bound_shift) - 1;
+
+   size_t slot(const Key& key) const noexcept;
+
+   std::vector<Key> slots_;
+   int shift_;
+};
+
+inline TranspositionTable::TranspositionTable(int log2_size)
+: slots_(size_t{1} << log2_size, Key{ 0, 0 }),
+  shift_(64 - log2_size)
+{ }
+
+inline TranspositionTable::Entry TranspositionTable::find(const Key& key)
+const noexcept
+{
+   assert((key.opponent & ~key_mask) == 0);
+   const auto& slot = slots_[this->slot(key)];
+   if ((slot.observer != key.observer) ||
+       ((slot.opponent & key_mask) != key.opponent)) {
+      return { 0, Bound::none };
+   }
+   auto bound = static_cast<Bound>((slot.opponent >> bound_shift) & 0xff);
+   auto value = static_cast<int8_t>(slot.opponent >> value_shift);
+   return { value, bound };
+}
+
+inline void TranspositionTable::insert(const Key& key,
+                                       int value,
+                                       Bound bound) noexcept
+{
+   assert((key.opponent & ~key_mask) == 0);
+   assert(value == static_cast<int8_t>(value));
+   auto opponent = key.opponent;
+   opponent |= uint64_t{static_cast<uint8_t>(bound)} << bound_shift;
+   opponent |= uint64_t{static_cast<uint8_t>(value)} << value_shift;
+   slots_[slot(key)] = { key.observer, opponent };
+}
+
+inline void TranspositionTable::clear() noexcept
+{
+   std::fill(slots_.begin(), slots_.end(), Key{ 0, 0 });
+}
+
+inline size_t TranspositionTable::slot(const Key& key) const noexcept
+{
+   // Fibonacci hashing spreads the packed fields across the whole table.
+   auto hash = key.observer ^ (key.opponent * 0xff51afd7ed558ccdull);
+   return static_cast<size_t>((hash * 0x9e3779b97f4a7c15ull) >> shift_);
+}
+
+#endif /* TranspositionTable_h */
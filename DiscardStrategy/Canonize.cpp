@@ -6,8 +6,11 @@
 //
 
 #include "Canonize.h"
-#include "CardSet.h"
+#include "CardSplitter.h"
+#include "DiscardDefs.h"
 #include <algorithm>
+#include <array>
+#include <bitset>
 #include <tuple>
 
 // Packs four uint16_t's into a uint64_t.
@@ -20,21 +23,446 @@ uint64_t pack(uint16_t w0, uint16_t w1, uint16_t w2, uint16_t w3) noexcept
    return result;
 }
 
+// Unpacks a uint64_t into four uint16_t's.
+std::array<uint16_t, 4> unpack(uint64_t key) noexcept
+{
+   return {
+      static_cast<uint16_t>(key),
+      static_cast<uint16_t>(key >> 16),
+      static_cast<uint16_t>(key >> 32),
+      static_cast<uint16_t>(key >> 48)
+   };
+}
+
+// Swaps a and b if they're out of order. Building block for the sorting
+// networks below; compiles to min/max without branches.
+template<typename T>
+inline void compare_exchange(T& a, T& b) noexcept
+{
+   auto lo = std::min(a, b);
+   b = std::max(a, b);
+   a = lo;
+}
+
+// Optimal sorting networks for the suits and the cards in a hand.
+static_assert(num_card_suits == 4);
+static_assert(num_cards_dealt_per_player == 6);
+
+template<typename T>
+inline void sort_suits(T& s0, T& s1, T& s2, T& s3) noexcept
+{
+   compare_exchange(s0, s1);
+   compare_exchange(s2, s3);
+   compare_exchange(s0, s2);
+   compare_exchange(s1, s3);
+   compare_exchange(s1, s2);
+}
+
+template<typename T>
+inline void sort_cards(T& c0, T& c1, T& c2, T& c3, T& c4, T& c5) noexcept
+{
+   compare_exchange(c1, c2);
+   compare_exchange(c4, c5);
+   compare_exchange(c0, c2);
+   compare_exchange(c3, c5);
+   compare_exchange(c0, c1);
+   compare_exchange(c3, c4);
+   compare_exchange(c2, c5);
+   compare_exchange(c0, c3);
+   compare_exchange(c1, c4);
+   compare_exchange(c2, c4);
+   compare_exchange(c1, c3);
+   compare_exchange(c2, c3);
+}
+
+// Canonical order sorts the suits by their flags, breaking ties by suit, and
+// then sorts the cards by suit and rank. Both sorts operate on small integers
+// with the sort key in the high bits:
+//    suit:  flags << 2 | suit index
+//    card:  position of suit << 4 | rank index
+constexpr int suit_bits = 2;
+constexpr int rank_bits = 4;
+static_assert(num_card_suits <= (1 << suit_bits));
+static_assert(num_card_ranks <= (1 << rank_bits));
+static_assert(num_card_ranks + suit_bits <= 16);
+
 uint64_t canonize(CardsDealt& cards) noexcept
 {
-   // Compute the suit equivalences.
-   CardSet equiv(cards.begin(), cards.end());
+   uint64_t key;
+   canonize(&cards, &key, 1);
+   return key;
+}
+
+void canonize(CardsDealt* hands, uint64_t* keys, size_t count) noexcept
+{
+   // Process the hands in blocks, one phase at a time. The data for each phase
+   // is stored by column, so the compiler can vectorize the sorting networks.
+   constexpr size_t block_size = 64;
+   using Column = std::array<uint16_t, block_size>;
+   std::array<Column, num_card_suits> suits;
+   std::array<Column, num_cards_dealt_per_player> sorted;
+
+   for (size_t begin = 0; begin < count; begin += block_size) {
+      auto n = std::min(block_size, count - begin);
+      auto block = hands + begin;
+
+      // Compute the suit flags ...
+      for (auto j = 0; j < num_card_suits; ++j) {
+         for (size_t i = 0; i < n; ++i) {
+            suits[j][i] = j;
+         }
+      }
+      for (size_t i = 0; i < n; ++i) {
+         for (auto c : block[i]) {
+            suits[c.suit() - min_card_suit][i] |=
+               1 << (rank_ordinal(c.rank()) + suit_bits);
+         }
+      }
+
+      // ... and sort them.
+      for (size_t i = 0; i < n; ++i) {
+         sort_suits(suits[0][i], suits[1][i], suits[2][i], suits[3][i]);
+      }
+
+      // Sort the cards by the position of their suit and their rank.
+      for (size_t i = 0; i < n; ++i) {
+         std::array<uint8_t, num_card_suits> position;
+         for (auto j = 0; j < num_card_suits; ++j) {
+            position[suits[j][i] & ((1 << suit_bits) - 1)] = j;
+         }
+         for (auto j = 0; j < num_cards_dealt_per_player; ++j) {
+            auto c = block[i][j];
+            sorted[j][i] = (position[c.suit() - min_card_suit] << rank_bits) |
+                           rank_ordinal(c.rank());
+         }
+      }
+      for (size_t i = 0; i < n; ++i) {
+         sort_cards(sorted[0][i], sorted[1][i], sorted[2][i],
+                    sorted[3][i], sorted[4][i], sorted[5][i]);
+      }
+
+      // Write out the canonized cards and the key.
+      for (size_t i = 0; i < n; ++i) {
+         for (auto j = 0; j < num_cards_dealt_per_player; ++j) {
+            auto position = sorted[j][i] >> rank_bits;
+            auto suit = suits[position][i] & ((1 << suit_bits) - 1);
+            auto rank = sorted[j][i] & ((1 << rank_bits) - 1);
+            block[i][j] = Card(rank + min_card_rank, suit + min_card_suit);
+         }
+         keys[begin + i] = pack(suits[0][i] >> suit_bits,
+                                suits[1][i] >> suit_bits,
+                                suits[2][i] >> suit_bits,
+                                suits[3][i] >> suit_bits);
+      }
+   }
+}
+
+// An equivalence class is a multiset of suit flags. To rank the classes, we
+// first group them by shape, i.e., the number of cards in each suit sorted in
+// descending order. Within a shape, the suits holding the same number of cards
+// form a multiset of flags which is ranked with the combinatorial number
+// system, and the ranks of these groups are combined in mixed radix.
+
+// It's way easier to hardcode the shapes for a standard Cribbage game than to
+// handle all possibilities.
+static_assert(num_card_ranks == 13);
+
+using Shape = std::array<int, num_card_suits>;
+
+constexpr int num_shapes = 9;
+constexpr std::array<Shape, num_shapes> shapes = {{
+   { 6, 0, 0, 0 },
+   { 5, 1, 0, 0 },
+   { 4, 2, 0, 0 },
+   { 4, 1, 1, 0 },
+   { 3, 3, 0, 0 },
+   { 3, 2, 1, 0 },
+   { 3, 1, 1, 1 },
+   { 2, 2, 2, 0 },
+   { 2, 2, 1, 1 }
+}};
+
+// C(n, k) = n!/((n - k)! * k!). Only intended for small values of k.
+constexpr int64_t binomial(int64_t n, int k) noexcept
+{
+   if ((k < 0) || (n < k)) {
+      return 0;
+   }
+   int64_t result = 1;
+   for (auto i = 0; i < k; ++i) {
+      result = (result * (n - i)) / (i + 1);
+   }
+   return result;
+}
+
+// Number of distinct multisets of flags for a group of suits that each hold
+// the same number of cards.
+constexpr int64_t group_size(int num_cards, int num_suits) noexcept
+{
+   return binomial(binomial(num_card_ranks, num_cards) + num_suits - 1,
+                   num_suits);
+}
 
-   // Canonize the input cards.
-   std::sort(cards.begin(), cards.end(), [&equiv](auto lhs, auto rhs) {
-      return std::make_tuple(equiv[lhs], lhs.suit(), lhs.rank()) <
-             std::make_tuple(equiv[rhs], rhs.suit(), rhs.rank());
+// Returns the end of the group of suits that begins at index 'begin'.
+constexpr int group_end(const Shape& shape, int begin) noexcept
+{
+   auto end = begin + 1;
+   while ((end < num_card_suits) && (shape[end] == shape[begin])) {
+      ++end;
+   }
+   return end;
+}
+
+// Number of equivalence classes with the given shape.
+constexpr int64_t shape_size(const Shape& shape) noexcept
+{
+   int64_t result = 1;
+   for (auto i = 0; (i < num_card_suits) && (shape[i] > 0); ) {
+      auto end = group_end(shape, i);
+      result *= group_size(shape[i], end - i);
+      i = end;
+   }
+   return result;
+}
+
+// Ordinal of the first equivalence class for each shape.
+constexpr std::array<int, num_shapes + 1> make_shape_offsets() noexcept
+{
+   std::array<int, num_shapes + 1> result{};
+   for (auto i = 0; i < num_shapes; ++i) {
+      result[i + 1] = result[i] + static_cast<int>(shape_size(shapes[i]));
+   }
+   return result;
+}
+
+constexpr auto shape_offsets = make_shape_offsets();
+static_assert(shape_offsets.back() == num_canonical_hands);
+
+// Ordinal of each suit flag among all flags with the same number of bits set.
+constexpr std::array<uint16_t, 1 << num_card_ranks> make_flag_ordinals() noexcept
+{
+   std::array<uint16_t, 1 << num_card_ranks> result{};
+   for (auto flags = 0; flags < (1 << num_card_ranks); ++flags) {
+      int64_t ordinal = 0;
+      auto bits = 0;
+      for (auto i = 0; i < num_card_ranks; ++i) {
+         if (flags & (1 << i)) {
+            ordinal += binomial(i, ++bits);
+         }
+      }
+      result[flags] = static_cast<uint16_t>(ordinal);
+   }
+   return result;
+}
+
+constexpr auto flag_ordinals = make_flag_ordinals();
+
+// Inverse of flag_ordinals.
+uint16_t flags_from_ordinal(int num_bits, int64_t ordinal) noexcept
+{
+   uint16_t flags = 0;
+   auto pos = num_card_ranks;
+   for (auto bits = num_bits; bits > 0; --bits) {
+      // Find the highest position that doesn't overshoot the ordinal.
+      while (binomial(--pos, bits) > ordinal) { }
+      flags |= (1 << pos);
+      ordinal -= binomial(pos, bits);
+   }
+   assert(ordinal == 0);
+   return flags;
+}
+
+int canonical_ordinal(uint64_t key) noexcept
+{
+   // Describe each suit by its number of cards and the ordinal of its flags.
+   struct SuitInfo {
+      int num_cards;
+      int ordinal;
+   };
+   std::array<SuitInfo, num_card_suits> suits;
+   auto flags = unpack(key);
+   for (auto i = 0; i < num_card_suits; ++i) {
+      suits[i].num_cards =
+         static_cast<int>(std::bitset<num_card_ranks>(flags[i]).count());
+      suits[i].ordinal = flag_ordinals[flags[i]];
+   }
+   std::sort(suits.begin(), suits.end(), [](auto lhs, auto rhs) {
+      return std::make_tuple(-lhs.num_cards, lhs.ordinal) <
+             std::make_tuple(-rhs.num_cards, rhs.ordinal);
+   });
+
+   Shape shape;
+   std::transform(suits.begin(), suits.end(), shape.begin(), [](auto s) {
+      return s.num_cards;
    });
+   auto i_shape = std::find(shapes.begin(), shapes.end(), shape);
+   assert(i_shape != shapes.end());
 
-   // Sort the suit flags.
-   equiv.sort();
+   int64_t result = 0;
+   for (auto i = 0; (i < num_card_suits) && (shape[i] > 0); ) {
+      auto end = group_end(shape, i);
+      // Within a group, the flag ordinals are sorted, so we can rank the
+      // multiset by treating ordinal + offset as a strictly increasing
+      // combination.
+      int64_t group = 0;
+      for (auto j = i; j < end; ++j) {
+         group += binomial(suits[j].ordinal + (j - i), j - i + 1);
+      }
+      result = (result * group_size(shape[i], end - i)) + group;
+      i = end;
+   }
 
-   // And convert them to a 64-bit integer for convenience.
-   return pack(equiv[0], equiv[1], equiv[2], equiv[3]);
+   auto offset = shape_offsets[std::distance(shapes.begin(), i_shape)];
+   return offset + static_cast<int>(result);
 }
 
+uint64_t canonical_key(int ordinal) noexcept
+{
+   assert(ordinal >= 0);
+   assert(ordinal < num_canonical_hands);
+
+   auto i_offset = std::upper_bound(shape_offsets.begin(),
+                                    shape_offsets.end(),
+                                    ordinal) - 1;
+   const auto& shape = shapes[std::distance(shape_offsets.begin(), i_offset)];
+   int64_t remainder = ordinal - *i_offset;
+
+   // The groups were combined with the first group most significant, so peel
+   // them off starting with the last group.
+   std::array<uint16_t, num_card_suits> flags{};
+   for (auto end = num_card_suits; end > 0; ) {
+      auto begin = end - 1;
+      while ((begin > 0) && (shape[begin - 1] == shape[end - 1])) {
+         --begin;
+      }
+      if (shape[begin] > 0) {
+         auto size = group_size(shape[begin], end - begin);
+         auto group = remainder % size;
+         remainder /= size;
+         for (auto j = end - 1; j >= begin; --j) {
+            auto k = j - begin + 1;
+            // Find the largest n such that C(n, k) <= group.
+            auto n = (k == 1) ? group : int64_t{k - 1};
+            while (binomial(n + 1, k) <= group) {
+               ++n;
+            }
+            group -= binomial(n, k);
+            flags[j] = flags_from_ordinal(shape[begin], n - (k - 1));
+         }
+      }
+      end = begin;
+   }
+   assert(remainder == 0);
+
+   // Keys always store the flags in sorted order.
+   std::sort(flags.begin(), flags.end());
+   return pack(flags[0], flags[1], flags[2], flags[3]);
+}
+
+CardsDealt canonical_cards(uint64_t key) noexcept
+{
+   // The flags in a key are sorted, so assigning the suits in order and the
+   // ranks in ascending order within each suit yields the canonical order.
+   CardsDealt cards;
+   auto next = cards.begin();
+   auto flags = unpack(key);
+   for (auto i = 0; i < num_card_suits; ++i) {
+      for (auto j = 0; j < num_card_ranks; ++j) {
+         if (flags[i] & (1 << j)) {
+            assert(next != cards.end());
+            *next++ = Card(j + min_card_rank, i + min_card_suit);
+         }
+      }
+   }
+   assert(next == cards.end());
+   // Canonizing the cards again should be a no-op.
+   [[maybe_unused]] CardsDealt copy(cards);
+   assert(canonize(copy) == key);
+   assert(copy == cards);
+   return cards;
+}
+
+int canonical_weight(uint64_t key) noexcept
+{
+   // Every permutation of the suits yields a distinct hand except for
+   // permutations among suits with the same flags. Since the flags are
+   // sorted, equal flags are adjacent.
+   auto flags = unpack(key);
+   auto result = factorial(num_card_suits);
+   for (auto i = 0; i < num_card_suits; ) {
+      auto end = i + 1;
+      while ((end < num_card_suits) && (flags[end] == flags[i])) {
+         ++end;
+      }
+      result /= factorial(end - i);
+      i = end;
+   }
+   return result;
+}
+
+EquivalentActions equivalent_actions(uint64_t key) noexcept
+{
+   EquivalentActions result;
+   for (auto a = 0; a < num_discard_actions; ++a) {
+      result[a] = static_cast<int8_t>(a);
+   }
+   // Only hands with interchangeable suits have fewer than 4! variations.
+   if (canonical_weight(key) == factorial(num_card_suits)) {
+      return result;
+   }
+
+   // Each action points to a lower equivalent action, so the lowest action is
+   // found by following the links.
+   auto find = [&result](int a) {
+      while (result[a] != a) {
+         a = result[a];
+      }
+      return a;
+   };
+
+   // The flags hold the ranks in each suit. Link the actions related by
+   // swapping each pair of suits with the same ranks.
+   auto flags = unpack(key);
+   auto cards = canonical_cards(key);
+   std::array<CardsDiscarded, num_discard_actions> discards;
+   CardSplitter splitter(cards);
+   for (auto a = 0; a < num_discard_actions; ++a) {
+      splitter.seek(a);
+      discards[a] = splitter.crib;
+   }
+   for (auto s1 = 0; s1 < num_card_suits; ++s1) {
+      for (auto s2 = s1 + 1; s2 < num_card_suits; ++s2) {
+         if ((flags[s1] == 0) || (flags[s1] != flags[s2])) {
+            continue;
+         }
+         auto swap = [s1, s2](Card card) {
+            auto suit = card.suit() - min_card_suit;
+            if (suit == s1) {
+               suit = s2;
+            } else if (suit == s2) {
+               suit = s1;
+            }
+            return Card(card.rank(), static_cast<Suit>(suit + min_card_suit));
+         };
+         for (auto a = 0; a < num_discard_actions; ++a) {
+            CardsDiscarded image = { swap(discards[a][0]),
+                                     swap(discards[a][1]) };
+            auto b = std::find_if(discards.begin(),
+                                  discards.end(),
+                                  [&image](const auto& discard) {
+               return std::is_permutation(image.begin(),
+                                          image.end(),
+                                          discard.begin());
+            });
+            assert(b != discards.end());
+            auto ra = find(a);
+            auto rb = find(static_cast<int>(b - discards.begin()));
+            result[std::max(ra, rb)] = static_cast<int8_t>(std::min(ra, rb));
+         }
+      }
+   }
+   for (auto a = 0; a < num_discard_actions; ++a) {
+      result[a] = static_cast<int8_t>(find(a));
+   }
+   return result;
+}
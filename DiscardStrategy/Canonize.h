@@ -9,10 +9,92 @@
 #define Canonize_h
 
 #include "Card.h"
+#include "DiscardDefs.h"
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <future>
+#include <thread>
+#include <vector>
 
 // Arranges the cards in canonical order and returns a key that uniquely
 // identifies the equivalence class for the hand.
 uint64_t canonize(CardsDealt& cards) noexcept;
+// Canonizes a batch of hands at once, which is faster than canonizing them
+// one at a time. The keys are written to an array of the same length.
+void canonize(CardsDealt* hands, uint64_t* keys, size_t count) noexcept;
+
+// Number of distinct equivalence classes, i.e., the number of distinct keys
+// that can be returned by canonize.
+constexpr int num_canonical_hands = 962'988;
+
+// Number of distinct hands that can be dealt to a player, i.e., C(52, 6).
+constexpr int num_hands_dealt = 20'358'520;
+
+// Maps a key returned by canonize to a dense ordinal in the range
+// [0, num_canonical_hands). Useful for storing per-class state in a flat
+// array instead of a map.
+int canonical_ordinal(uint64_t key) noexcept;
+
+// Inverse of canonical_ordinal.
+uint64_t canonical_key(int ordinal) noexcept;
+
+// Returns the cards for the equivalence class identified by key, arranged in
+// canonical order.
+CardsDealt canonical_cards(uint64_t key) noexcept;
+
+// Returns the number of distinct hands that belong to the equivalence class
+// identified by key.
+int canonical_weight(uint64_t key) noexcept;
+
+// Maps each discard action for the class identified by key to the lowest
+// action that's equivalent to it, i.e., the same discard after swapping suits
+// that hold the same ranks. Actions are numbered as by CardSplitter for the
+// canonical cards.
+using EquivalentActions = std::array<int8_t, num_discard_actions>;
+EquivalentActions equivalent_actions(uint64_t key) noexcept;
+
+// Describes an equivalence class of hands.
+struct CanonicalHand {
+   int ordinal;
+   uint64_t key;
+   // Cards in canonical order.
+   CardsDealt cards;
+   // Number of distinct hands that belong to the class.
+   int weight;
+};
+
+// Invokes fn for every equivalence class whose ordinal is congruent to idx
+// modulo num_workers. Useful for splitting the classes between threads.
+template<typename Fn>
+void generate_canonical_hands(int idx, int num_workers, Fn fn)
+{
+   for (auto i = idx; i < num_canonical_hands; i += num_workers) {
+      CanonicalHand hand;
+      hand.ordinal = i;
+      hand.key = canonical_key(i);
+      hand.cards = canonical_cards(hand.key);
+      hand.weight = canonical_weight(hand.key);
+      fn(static_cast<const CanonicalHand&>(hand));
+   }
+}
+
+// Invokes fn exactly once for every equivalence class. The classes are split
+// across all available threads, so fn must be safe to invoke concurrently.
+template<typename Fn>
+void generate_canonical_hands(Fn fn)
+{
+   auto num_workers = static_cast<int>(std::thread::hardware_concurrency());
+
+   // Launch the workers ...
+   std::vector<std::future<void>> futures;
+   for (auto i = 0; i < num_workers; ++i) {
+      futures.push_back(std::async(std::launch::async, [i, num_workers, &fn]() {
+         generate_canonical_hands(i, num_workers, fn);
+      }));
+   }
+   // ... and wait for them to complete.
+   std::for_each(futures.begin(), futures.end(), [](auto& f){ f.get(); });
+}
 
 #endif /* Canonize_h */
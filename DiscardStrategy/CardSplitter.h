@@ -15,15 +15,57 @@
 class CardCombos
 {
 public:
+   constexpr CardCombos() noexcept;
+
    // Indices of cards for each possible combo.
-   int hand[num_discard_actions][num_cards_in_hand];
-   int crib[num_discard_actions][num_cards_discarded_per_player];
+   int hand[num_discard_actions][num_cards_in_hand] = {};
+   int crib[num_discard_actions][num_cards_discarded_per_player] = {};
+};
+
+constexpr CardCombos::CardCombos() noexcept
+{
+   // Algorithm from Prof. Nathan Wodarz
 
-   static const CardCombos& get() noexcept;
+   // Start by generating the crib combos.
+   int combo[num_cards_discarded_per_player] = {};
+   for (auto i = 0; i < num_cards_discarded_per_player; ++i) {
+      combo[i] = i;
+   }
 
-private:
-   CardCombos() noexcept;
-};
+   for (auto i = 0; i < num_discard_actions; ++i) {
+      if (i > 0) {
+         // Find the rightmost element not at its maximum value
+         auto m = num_cards_discarded_per_player - 1;
+         auto max_val = num_cards_dealt_per_player - 1;
+         while (combo[m] == max_val) {
+            --m;
+            --max_val;
+         }
+
+         // Don't change anything before that element
+         // Increment the element found above
+         ++combo[m];
+
+         // Each additional element is one more than previous
+         while (++m < num_cards_discarded_per_player) {
+            combo[m] = combo[m - 1] + 1;
+         }
+      }
+
+      // Store the combo, and put every card not in the crib in the hand.
+      auto j = 0, k = 0;
+      for (auto card = 0; card < num_cards_dealt_per_player; ++card) {
+         if ((k < num_cards_discarded_per_player) && (combo[k] == card)) {
+            crib[i][k++] = card;
+         } else {
+            hand[i][j++] = card;
+         }
+      }
+   }
+}
+
+// Every combo, generated at compile time.
+constexpr CardCombos card_combos;
 
 // Enumerates all possible ways to discard from a given set of cards.
 class CardSplitter
@@ -50,7 +92,6 @@ private:
    // Loads the hand & crib with the cards for the given value of pos.
    void load() noexcept;
 
-   const CardCombos& combos_ = CardCombos::get();
    int pos_ = 0;
 };
 
@@ -15,6 +15,13 @@ DiscardAnalyzer::DiscardAnalyzer(Deck& deck) noexcept
   splitter_(cards_)
 { }
 
+DiscardAnalyzer::DiscardAnalyzer(const CardsDealt& canonical,
+                                 uint64_t key) noexcept
+: cards_(canonical),
+  key_(key),
+  splitter_(cards_)
+{ }
+
 int DiscardAnalyzer::hand_points(Card starter) const noexcept
 {
    return HandScore(splitter_.hand.begin(),
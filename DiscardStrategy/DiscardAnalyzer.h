@@ -17,6 +17,8 @@ class DiscardAnalyzer
 {
 public:
    explicit DiscardAnalyzer(Deck& deck) noexcept;
+   // Analyzes cards that have already been canonized.
+   DiscardAnalyzer(const CardsDealt& canonical, uint64_t key) noexcept;
 
    // Returns the canonical key for the hand.
    uint64_t key() const noexcept;
@@ -7,178 +7,581 @@
 
 #include "DiscardSimulator.h"
 #include "Canonize.h"
+#include "CardSplitter.h"
 #include "DiscardAnalyzer.h"
 #include "FileIO.h"
 #include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
 #include <future>
 #include <limits>
+#include <random>
 #include <vector>
 
+using namespace std::chrono;
+
+namespace {
+
+// Points scored by the cards kept for each action, summed over every card the
+// observer could see as the starter.
+using ActionHandPoints = std::array<int16_t, num_discard_actions>;
+
+// Returns the observer's hand points for every class, indexed by canonical
+// ordinal. The table is built on first use.
+const std::vector<ActionHandPoints>& observer_hand_points()
+{
+   static const auto table = []() {
+      std::vector<ActionHandPoints> result(num_canonical_hands);
+      for (auto i = 0; i < num_canonical_hands; ++i) {
+         auto cards = canonical_cards(canonical_key(i));
+         StarterSet starters;
+         starters.erase(cards.begin(), cards.end());
+         CardSplitter splitter(cards);
+         for (auto a = 0; a < num_discard_actions; ++a) {
+            splitter.seek(a);
+            HandScore kept(splitter.hand.begin(), splitter.hand.end(), false);
+            auto points = kept.score_all(starters);
+            assert(points <= std::numeric_limits<int16_t>::max());
+            result[i][a] = static_cast<int16_t>(points);
+         }
+      }
+      return result;
+   }();
+   return table;
+}
+
+} // namespace
+
 int DiscardSimulator::PointsScored::observer_net() const noexcept
 {
    return (observer_play + observer_hand) - (opponent_play + opponent_hand);
 }
 
-void DiscardSimulator::ActionResult::update(const PointsScored& points) noexcept
+void DiscardSimulator::ActionResult::update(int observer_net) noexcept
+{
+   observer_net_points_ += observer_net;
+   observer_net_squares_ += int64_t{observer_net} * observer_net;
+}
+
+void DiscardSimulator::ActionResult::merge(const ActionResult& other) noexcept
 {
-   observer_net_points_ += points.observer_net();
+   observer_net_points_ += other.observer_net_points_;
+   observer_net_squares_ += other.observer_net_squares_;
 }
 
-int DiscardSimulator::ActionResult::observer_net_points() const noexcept
+int64_t DiscardSimulator::ActionResult::observer_net_points() const noexcept
 {
    return observer_net_points_;
 }
 
+double DiscardSimulator::ActionResult::mean(int64_t count) const noexcept
+{
+   assert(count > 0);
+   return static_cast<double>(observer_net_points_) / count;
+}
+
+double DiscardSimulator::ActionResult::std_error(int64_t count) const noexcept
+{
+   assert(count > 1);
+   auto sum = static_cast<double>(observer_net_points_);
+   auto squares = static_cast<double>(observer_net_squares_);
+   auto variance = (squares - (sum * sum / count)) / (count - 1);
+   return std::sqrt(std::max(variance, 0.0) / count);
+}
+
+void DiscardSimulator::State::merge(const State& other) noexcept
+{
+   count += other.count;
+   for (auto a = 0; a < num_discard_actions; ++a) {
+      results[a].merge(other.results[a]);
+   }
+}
+
 DiscardSimulator::DiscardSimulator(const DiscardTable& opponent,
-                                   const HandVsHand& hvh) noexcept
-: opponent_(opponent),
-  hvh_(hvh)
-{
-   // Create all the entries ahead of time, so the map will be read-only
-   // during computation. This allows multiple workers to access the map
-   // without locking.
-   generate_cards_dealt([this](auto cards) {
-      auto key = canonize(cards);
-      auto i = entries_.find(key);
-      if (i == entries_.end()) {
-         entries_[key];
-      }
-   });
+                                   const HandVsHand& hvh,
+                                   Mode mode) noexcept
+: entries_(num_canonical_hands),
+  opponent_(opponent),
+  hvh_(hvh),
+  opponent_id_(make_opponent_id(opponent)),
+  mode_(mode)
+{
+   if (mode == Mode::control_variate) {
+      // Build the table up front rather than in the middle of a batch.
+      observer_hand_points();
+   }
+   switch (mode) {
+      case Mode::sampled_starter:
+         scale_ = 1;
+         term_weight_ = 1;
+         break;
+
+      case Mode::all_starters:
+         scale_ = num_deck_starters;
+         term_weight_ = 1;
+         break;
+
+      case Mode::control_variate:
+         // The observer's hand is summed over a different number of starters
+         // than everything else.
+         scale_ = num_deck_starters * num_observer_starters;
+         term_weight_ = num_observer_starters;
+         break;
+   }
 }
 
 void DiscardSimulator::simulate(int64_t num_hands)
 {
+   // Each worker gets its own shard with one bucket for each merge worker.
    auto concurrency = std::thread::hardware_concurrency();
+   std::vector<Shard> shards(concurrency, Shard(concurrency));
 
-   // Compute number of iterations each worker should perform.
-   auto iter_by_worker_n = num_hands / concurrency;
-   auto iter_by_worker_0 =
-      num_hands - ((concurrency - 1) * iter_by_worker_n);
+   while (num_hands > 0) {
+      num_hands -= simulate_batch(num_hands, shards);
+      checkpoint();
+   }
+}
 
-   // Launch the workers ...
-   std::vector<std::future<void>> futures;
-   for (auto i = 0; i < concurrency; ++i) {
-      auto iter_by_worker = (i == 0) ? iter_by_worker_0 : iter_by_worker_n;
-      futures.push_back(std::async(std::launch::async,
-                                   &DiscardSimulator::simulate_worker,
-                                   this,
-                                   iter_by_worker));
+int64_t DiscardSimulator::simulate(int64_t num_hands,
+                                   const StoppingRule& rule)
+{
+   auto concurrency = std::thread::hardware_concurrency();
+   std::vector<Shard> shards(concurrency, Shard(concurrency));
+
+   auto start = steady_clock::now();
+   auto last_check = start;
+   int64_t num_simulated = 0;
+   if (importance_sampling_) {
+      // Results may have been loaded, so start from their distribution.
+      update_sampling(rule);
    }
-   // ... and wait for them to complete.
-   std::for_each(futures.begin(), futures.end(), [](auto& f){ f.get(); });
+
+   while (num_simulated < num_hands) {
+      num_simulated += simulate_batch(num_hands - num_simulated, shards);
+      checkpoint();
+
+      auto now = steady_clock::now();
+      if (duration_cast<seconds>(now - start) >= rule.budget) {
+         break;
+      }
+      // Checking every hand is moderately expensive, so don't do it after
+      // every batch.
+      if (duration_cast<seconds>(now - last_check) >= check_interval) {
+         if (is_decided(rule)) {
+            break;
+         }
+         if (importance_sampling_) {
+            update_sampling(rule);
+         }
+         last_check = now;
+      }
+   }
+
+   return num_simulated;
+}
+
+bool DiscardSimulator::is_decided(const StoppingRule& rule) const noexcept
+{
+   for (auto i = 0; i < num_canonical_hands; ++i) {
+      const auto& entry = entries_[i];
+      auto equivalent = equivalent_actions(canonical_key(i));
+      if (!is_decided(entry.dealer, equivalent, rule, scale_) ||
+          !is_decided(entry.pone, equivalent, rule, scale_)) {
+         return false;
+      }
+   }
+   return true;
+}
+
+void DiscardSimulator::set_importance_sampling(bool enabled) noexcept
+{
+   importance_sampling_ = enabled;
+   if (!enabled) {
+      sampling_cdf_.clear();
+   }
+}
+
+void DiscardSimulator::set_seed(uint64_t seed) noexcept
+{
+   seeded_ = true;
+   seed_ = seed;
+   next_stream_ = 0;
+}
+
+int64_t DiscardSimulator::num_hands() const noexcept
+{
+   // Every hand updates exactly one dealer state.
+   int64_t result = 0;
+   for (const auto& entry : entries_) {
+      result += entry.dealer.count;
+   }
+   return result;
+}
+
+void DiscardSimulator::set_checkpoint(const char* filename,
+                                      std::chrono::seconds interval)
+{
+   checkpoint_file_ = filename;
+   checkpoint_interval_ = interval;
+   last_checkpoint_ = steady_clock::now();
 }
 
 double DiscardSimulator::best_response(DiscardTable& response) const noexcept
 {
    response.clear();
 
-   // Compute the best response for every entry. Use int64_t to avoid overflow.
-   int64_t points_sum = 0;
-   int64_t count_sum = 0;
-   for (const auto& [key, entry] : entries_) {
+   // Compute the best response for every entry. Each hand's mean is weighted
+   // by the number of deals in its class, since importance sampling doesn't
+   // simulate the classes in proportion to their frequency.
+   auto points_sum = 0.0;
+   int64_t weight_sum = 0;
+   for (auto i = 0; i < num_canonical_hands; ++i) {
+      const auto& entry = entries_[i];
+      auto key = canonical_key(i);
       auto [d_action, d_points] = find_best(entry.dealer.results);
       auto [p_action, p_points] = find_best(entry.pone.results);
-      points_sum += d_points + p_points;
-      count_sum += entry.dealer.count + entry.pone.count;
       response.insert(key, d_action, p_action);
+      auto count = entry.dealer.count + entry.pone.count;
+      if (count > 0) {
+         auto weight = canonical_weight(key);
+         points_sum += static_cast<double>(d_points + p_points) * weight /
+                       count;
+         weight_sum += weight;
+      }
    }
 
    // Compute the overall exploitability.
-   return static_cast<double>(points_sum) / static_cast<double>(count_sum);
+   if (weight_sum == 0) {
+      return 0.0;
+   }
+   return points_sum / (static_cast<double>(weight_sum) * scale_);
 }
 
-bool DiscardSimulator::load(const char* filename)
+bool DiscardSimulator::mean_points(int ordinal,
+                                   bool dealer,
+                                   ActionPoints& points) const noexcept
 {
-   std::ifstream istrm(filename, std::ios::binary);
-   if (!istrm.is_open()) {
+   const auto& entry = entries_[ordinal];
+   const auto& state = dealer ? entry.dealer : entry.pone;
+   if (state.count == 0) {
       return false;
    }
-   MapType tmp;
-   if (!read_pod_map(istrm, tmp)) {
-      return false;
+   for (auto a = 0; a < num_discard_actions; ++a) {
+      points[a] = state.results[a].mean(state.count) / scale_;
    }
-   if (!read_complete(istrm)) {
+   return true;
+}
+
+bool DiscardSimulator::load(const char* filename)
+{
+   EntryArray tmp;
+   if (!read_entries(filename, tmp)) {
       return false;
    }
    entries_.swap(tmp);
    return true;
-
 }
 
 void DiscardSimulator::save(const char* filename) const noexcept
 {
    std::ofstream ostrm(filename, std::ios::binary | std::ios::trunc);
-   write_pod_map(ostrm, entries_);
+   write_pod(ostrm, FileHeader{ file_magic,
+                                file_version,
+                                opponent_id_,
+                                static_cast<uint64_t>(mode_) });
+   write_pod_vector(ostrm, entries_);
 }
 
-void DiscardSimulator::simulate_worker(int64_t num_hands) noexcept
+bool DiscardSimulator::merge(const char* filename)
 {
-   Deck deck;
+   EntryArray tmp;
+   if (!read_entries(filename, tmp)) {
+      return false;
+   }
+   for (auto i = 0; i < num_canonical_hands; ++i) {
+      entries_[i].dealer.merge(tmp[i].dealer);
+      entries_[i].pone.merge(tmp[i].pone);
+   }
+   return true;
+}
+
+bool DiscardSimulator::matches(const char* filename) const
+{
+   std::ifstream istrm(filename, std::ios::binary);
+   FileHeader header;
+   return istrm.is_open() && read_pod(istrm, header) && header_matches(header);
+}
+
+int64_t DiscardSimulator::simulate_batch(int64_t max_hands,
+                                         std::vector<Shard>& shards)
+{
+   const auto concurrency = static_cast<int>(shards.size());
+   auto batch = std::min<int64_t>(max_hands, hands_per_batch * concurrency);
+
+   // Compute number of iterations each worker should perform.
+   auto iter_by_worker_n = batch / concurrency;
+   auto iter_by_worker_0 =
+      batch - ((concurrency - 1) * iter_by_worker_n);
+
+   // Launch the workers ...
+   std::vector<std::future<void>> futures;
+   for (auto i = 0; i < concurrency; ++i) {
+      auto iter_by_worker = (i == 0) ? iter_by_worker_0 : iter_by_worker_n;
+      futures.push_back(std::async(std::launch::async,
+                                   &DiscardSimulator::simulate_worker,
+                                   this,
+                                   iter_by_worker,
+                                   next_stream_++,
+                                   std::ref(shards[i])));
+   }
+   // ... and wait for them to complete.
+   std::for_each(futures.begin(), futures.end(), [](auto& f){ f.get(); });
+
+   // Now merge the shards. Each bucket covers a disjoint range of entries,
+   // so the buckets can be merged in parallel.
+   futures.clear();
+   for (auto i = 0; i < concurrency; ++i) {
+      futures.push_back(std::async(std::launch::async,
+                                   &DiscardSimulator::merge_worker,
+                                   this,
+                                   i,
+                                   std::ref(shards)));
+   }
+   std::for_each(futures.begin(), futures.end(), [](auto& f){ f.get(); });
+
+   return batch;
+}
+
+void DiscardSimulator::simulate_worker(int64_t num_hands,
+                                       uint64_t stream,
+                                       Shard& shard) const noexcept
+{
+   const int64_t num_buckets = shard.size();
+   // The deck and the sampling distribution draw from different streams.
+   auto rng = seeded_ ? pcg32(seed_, 2 * stream)
+                      : pcg32(pcg_extras::seed_seq_from<std::random_device>());
+   Deck deck(seeded_ ? pcg32(seed_, (2 * stream) + 1)
+                     : pcg32(pcg_extras::seed_seq_from<std::random_device>()));
+
+   // Hands are dealt in blocks, so they can be canonized in a single batch.
+   // Even entries are the opponent's hands; odd entries are the observer's.
+   std::array<CardsDealt, 2 * deal_block_size> hands;
+   std::array<uint64_t, 2 * deal_block_size> keys;
+   std::array<Card, deal_block_size> starters;
+   auto block_pos = deal_block_size;
+
    while (num_hands-- > 0) {
-      deck.shuffle();
+      if (block_pos == deal_block_size) {
+         for (auto i = 0; i < deal_block_size; ++i) {
+            if (!sampling_cdf_.empty()) {
+               deal_weighted(deck,
+                             rng,
+                             hands[2 * i],
+                             hands[(2 * i) + 1],
+                             starters[i]);
+               continue;
+            }
+            deck.shuffle();
+            hands[2 * i] = deal_cards(deck);
+            hands[(2 * i) + 1] = deal_cards(deck);
+            starters[i] = deck.deal_card();
+         }
+         canonize(hands.data(), keys.data(), hands.size());
+         block_pos = 0;
+      }
 
-      // Deal the hands and the starter card.
-      DiscardAnalyzer opponent(deck);
-      DiscardAnalyzer observer(deck);
-      const auto starter = deck.deal_card();
+      // Unpack the hands and the starter card.
+      const auto& opponent_cards = hands[2 * block_pos];
+      const auto& observer_cards = hands[(2 * block_pos) + 1];
+      DiscardAnalyzer opponent(opponent_cards, keys[2 * block_pos]);
+      DiscardAnalyzer observer(observer_cards, keys[(2 * block_pos) + 1]);
+      const auto starter = starters[block_pos];
+      ++block_pos;
 
-      // Look up the corresponding state for each hand.
+      // Unless a single starter is sampled, hands are scored against every
+      // card that could have been the starter.
+      StarterSet deck_starters, observer_starters;
+      if (mode_ != Mode::sampled_starter) {
+         observer_starters.erase(observer_cards.begin(), observer_cards.end());
+         deck_starters = observer_starters;
+         deck_starters.erase(opponent_cards.begin(), opponent_cards.end());
+      }
+      auto score = [&](const HandScore& hand) {
+         if (mode_ == Mode::sampled_starter) {
+            return hand.score(starter);
+         }
+         return hand.score_all(deck_starters);
+      };
+
+      // Look up the opponent's actions and the observer's entry.
       auto actions = opponent_.find(opponent.key());
-      Entry& entry = entries_[observer.key()];
+      auto ordinal = canonical_ordinal(observer.key());
+      const auto* hand_points = (mode_ == Mode::control_variate) ?
+                                &observer_hand_points()[ordinal] :
+                                nullptr;
+      auto& bucket = shard[(ordinal * num_buckets) / num_canonical_hands];
+
+      // Results are calculated for all possible observer actions. Only the
+      // crib depends on the opponent's action, so the rest is computed once.
+      std::array<ActionInfo, num_discard_actions> infos;
+      for (auto a = 0; a < num_discard_actions; ++a) {
+         observer.take_action(a);
+         auto& info = infos[a];
+         if (mode_ == Mode::control_variate) {
+            // The observer's cards are all that's needed to compute the
+            // expected value of the hand exactly.
+            info.hand_points = (*hand_points)[a] * num_deck_starters;
+         } else {
+            HandScore kept(observer.kept().begin(),
+                           observer.kept().end(),
+                           false);
+            info.hand_points = score(kept) * term_weight_;
+         }
+         info.ordinal = hvh_.ordinal(observer.kept());
+         info.discarded = observer.discarded();
+         info.crib.update(info.discarded.begin(), info.discarded.end());
+      }
 
       // Evaluate the hands both ways. It's more efficient to do both at once
       // since all the processing above is shared.
       for (auto dealer : { false, true }) {
          // Opponent always takes a single action.
          opponent.take_action(dealer ? actions.pone : actions.dealer);
-         auto opponent_hand_points = opponent.hand_points(starter);
+         HandScore opponent_kept(opponent.kept().begin(),
+                                 opponent.kept().end(),
+                                 false);
+         auto opponent_hand_points = score(opponent_kept) * term_weight_;
          auto opponent_ordinal = hvh_.ordinal(opponent.kept());
+         const auto& opponent_discarded = opponent.discarded();
 
-         // Results are calculated for all possible observer actions.
-         std::array<PointsScored, num_discard_actions> outcomes;
+         Delta delta = { ordinal, dealer, {} };
          for (auto a = 0; a < num_discard_actions; ++a) {
-            observer.take_action(a);
-            auto observer_hand_points = observer.hand_points(starter);
-            auto observer_ordinal = hvh_.ordinal(observer.kept());
+            const auto& info = infos[a];
+            auto observer_hand_points = info.hand_points;
+            auto observer_ordinal = info.ordinal;
 
             // Doesn't matter which way we compute crib points.
-            auto crib_points = observer.crib_points(opponent.discarded(),
-                                                    starter);
-            assert(crib_points == opponent.crib_points(observer.discarded(),
-                                                       starter));
+            auto crib = info.crib;
+            crib.update(opponent_discarded.begin(), opponent_discarded.end());
+            auto crib_points = score(crib) * term_weight_;
+            assert((mode_ != Mode::sampled_starter) ||
+                   (crib_points == opponent.crib_points(info.discarded,
+                                                        starter)));
 
-            auto& outcome = outcomes[a];
+            // Card play doesn't depend on the starter.
+            PointsScored outcome;
             if (dealer) {
                auto& cell = hvh_[observer_ordinal][opponent_ordinal];
-               outcome.observer_play = cell.dealer_points;
+               outcome.observer_play = cell.dealer_points * scale_;
                outcome.observer_hand = observer_hand_points + crib_points;
-               outcome.opponent_play = cell.pone_points;
+               outcome.opponent_play = cell.pone_points * scale_;
                outcome.opponent_hand = opponent_hand_points;
             } else {
                auto& cell = hvh_[opponent_ordinal][observer_ordinal];
-               outcome.observer_play = cell.pone_points;
+               outcome.observer_play = cell.pone_points * scale_;
                outcome.observer_hand = observer_hand_points;
-               outcome.opponent_play = cell.dealer_points;
+               outcome.opponent_play = cell.dealer_points * scale_;
                outcome.opponent_hand = opponent_hand_points + crib_points;
             }
+            delta.observer_net[a] = outcome.observer_net();
          }
 
-         // Now that all computations are complete, grab the lock and update
-         // the shared state.
-         auto& state = dealer ? entry.dealer : entry.pone;
-         SpinlockGuard guard(state.lock);
+         // Buffer the results; they're merged into the shared state once the
+         // batch is complete.
+         bucket.push_back(delta);
+      }
+   }
+}
+
+void DiscardSimulator::merge_worker(int bucket,
+                                    std::vector<Shard>& shards) noexcept
+{
+   // Always merge the shards in the same order, so the results don't depend
+   // on thread scheduling.
+   for (auto& shard : shards) {
+      for (const auto& delta : shard[bucket]) {
+         auto& entry = entries_[delta.ordinal];
+         auto& state = delta.dealer ? entry.dealer : entry.pone;
          ++(state.count);
          for (auto a = 0; a < num_discard_actions; ++a) {
-            state.results[a].update(outcomes[a]);
+            state.results[a].update(delta.observer_net[a]);
          }
       }
+      shard[bucket].clear();
+   }
+}
+
+void DiscardSimulator::checkpoint()
+{
+   if (checkpoint_file_.empty()) {
+      return;
+   }
+   auto now = steady_clock::now();
+   if (duration_cast<seconds>(now - last_checkpoint_) < checkpoint_interval_) {
+      return;
    }
+   // Write to a temporary file and rename it, so a crash during the save
+   // doesn't destroy the previous checkpoint.
+   auto tmp = checkpoint_file_ + ".tmp";
+   save(tmp.c_str());
+   std::rename(tmp.c_str(), checkpoint_file_.c_str());
+   last_checkpoint_ = now;
 }
 
-std::pair<int, int>
+void DiscardSimulator::update_sampling(const StoppingRule& rule)
+{
+   sampling_cdf_.resize(num_canonical_hands);
+   auto total = 0.0;
+   for (auto i = 0; i < num_canonical_hands; ++i) {
+      const auto& entry = entries_[i];
+      auto key = canonical_key(i);
+      auto equivalent = equivalent_actions(key);
+      // Every deal updates both states, so sample for the one most in doubt.
+      auto weight = std::max(
+         sampling_weight(entry.dealer, equivalent, rule, scale_),
+         sampling_weight(entry.pone, equivalent, rule, scale_)
+      );
+      total += weight * canonical_weight(key);
+      sampling_cdf_[i] = total;
+   }
+}
+
+void DiscardSimulator::deal_weighted(Deck& deck,
+                                     pcg32& rng,
+                                     CardsDealt& opponent,
+                                     CardsDealt& observer,
+                                     Card& starter) const noexcept
+{
+   std::uniform_real_distribution<double> dist(0.0, sampling_cdf_.back());
+   auto i = std::upper_bound(sampling_cdf_.begin(),
+                             sampling_cdf_.end(),
+                             dist(rng));
+   auto ordinal = static_cast<int>(std::distance(sampling_cdf_.begin(), i));
+   ordinal = std::min(ordinal, num_canonical_hands - 1);
+   // Scores don't depend on the suits, so the canonical cards are as good as
+   // any other hand in the class.
+   observer = canonical_cards(canonical_key(ordinal));
+
+   // Deal the rest from the cards the observer doesn't hold. Shuffle enough
+   // cards to skip over all of them.
+   deck.shuffle(num_cards_dealt_per_round + num_cards_dealt_per_player);
+   auto deal = [&deck, &observer]() {
+      auto card = deck.deal_card();
+      while (std::find(observer.begin(), observer.end(), card) !=
+             observer.end()) {
+         card = deck.deal_card();
+      }
+      return card;
+   };
+   std::generate(opponent.begin(), opponent.end(), deal);
+   starter = deal();
+}
+
+std::pair<int, int64_t>
 DiscardSimulator::find_best(const ActionResults& results) noexcept
 {
-   auto max_points = std::numeric_limits<int>::min();
+   auto max_points = std::numeric_limits<int64_t>::min();
    int best_action = 0;
    for (auto a = 0; a < num_discard_actions; ++a) {
       auto points = results[a].observer_net_points();
@@ -189,3 +592,121 @@ DiscardSimulator::find_best(const ActionResults& results) noexcept
    }
    return { best_action, max_points };
 }
+
+std::pair<double, double>
+DiscardSimulator::separation(const State& state,
+                             const EquivalentActions& equivalent,
+                             int scale) noexcept
+{
+   auto [best, best_points] = find_best(state.results);
+   auto runner_up = -1;
+   for (auto a = 0; a < num_discard_actions; ++a) {
+      if ((equivalent[a] != equivalent[best]) && ((runner_up == -1) ||
+          (state.results[a].observer_net_points() >
+           state.results[runner_up].observer_net_points()))) {
+         runner_up = a;
+      }
+   }
+   if (runner_up == -1) {
+      // Every action is equivalent, so there's nothing to decide.
+      return { std::numeric_limits<double>::infinity(), 0.0 };
+   }
+
+   const auto& first = state.results[best];
+   const auto& second = state.results[runner_up];
+   auto gap = (first.mean(state.count) - second.mean(state.count)) / scale;
+   // The actions are evaluated on the same deals, so their results are
+   // positively correlated. Treating them as independent overstates the
+   // error, which errs on the side of simulating longer.
+   auto error = std::hypot(first.std_error(state.count),
+                           second.std_error(state.count)) / scale;
+   return { gap, error };
+}
+
+bool DiscardSimulator::is_decided(const State& state,
+                                  const EquivalentActions& equivalent,
+                                  const StoppingRule& rule,
+                                  int scale) noexcept
+{
+   if (state.count < std::max<int64_t>(rule.min_count, 2)) {
+      return false;
+   }
+   auto [gap, error] = separation(state, equivalent, scale);
+   auto margin = rule.z_score * error;
+   // A small observed gap isn't enough on its own: the true gap could still
+   // be as large as gap + margin.
+   return (gap >= margin) || (gap + margin <= rule.tolerance);
+}
+
+double DiscardSimulator::sampling_weight(const State& state,
+                                         const EquivalentActions& equivalent,
+                                         const StoppingRule& rule,
+                                         int scale) noexcept
+{
+   if (state.count < std::max<int64_t>(rule.min_count, 2)) {
+      return 1.0;
+   }
+   auto [gap, error] = separation(state, equivalent, scale);
+   auto margin = rule.z_score * error;
+   // Same indifference zone as is_decided. Otherwise, hands with tied
+   // actions would keep the full weight forever. A small observed gap isn't
+   // enough: those are the close calls that need more samples.
+   if (gap + margin <= rule.tolerance) {
+      return decided_weight;
+   }
+   if (gap <= margin) {
+      return 1.0;
+   }
+   return std::max(margin / gap, decided_weight);
+}
+
+bool DiscardSimulator::read_entries(const char* filename,
+                                    EntryArray& entries) const
+{
+   std::ifstream istrm(filename, std::ios::binary);
+   if (!istrm.is_open()) {
+      return false;
+   }
+   FileHeader header;
+   if (!read_pod(istrm, header)) {
+      return false;
+   }
+   if (!header_matches(header)) {
+      return false;
+   }
+   EntryArray tmp;
+   if (!read_pod_vector(istrm, tmp)) {
+      return false;
+   }
+   if (tmp.size() != num_canonical_hands) {
+      return false;
+   }
+   if (!read_complete(istrm)) {
+      return false;
+   }
+   entries.swap(tmp);
+   return true;
+}
+
+bool DiscardSimulator::header_matches(const FileHeader& header) const noexcept
+{
+   return (header.magic == file_magic) &&
+          (header.version == file_version) &&
+          (header.opponent_id == opponent_id_) &&
+          (header.mode == static_cast<uint64_t>(mode_));
+}
+
+uint64_t DiscardSimulator::make_opponent_id(const DiscardTable& opponent)
+noexcept
+{
+   // FNV-1a hash of the actions in canonical order.
+   uint64_t result = 0xcbf29ce484222325;
+   for (auto i = 0; i < num_canonical_hands; ++i) {
+      auto actions = opponent.find(canonical_key(i));
+      for (auto action : { actions.dealer, actions.pone }) {
+         result ^= static_cast<uint64_t>(action);
+         result *= 0x100000001b3;
+      }
+   }
+   return result;
+}
@@ -8,33 +8,113 @@
 #ifndef DiscardSimulator_h
 #define DiscardSimulator_h
 
+#include "Canonize.h"
+#include "Deck.h"
 #include "DiscardDefs.h"
 #include "DiscardTable.h"
+#include "HandScore.h"
 #include "HandVsHand.h"
-#include "Spinlock.h"
 #include <array>
-#include <unordered_map>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "pcg_random.hpp"
 
 // Simulates every possible discard action vs. a given opponent strategy and
 // collects various statistics.
 class DiscardSimulator
 {
 public:
+   // Criteria for ending a simulation before all the hands have been dealt.
+   struct StoppingRule {
+      // A hand is decided once the best action leads the runner-up by at
+      // least this many standard errors ...
+      double z_score = 3.0;
+      // ... or the whole confidence interval for the gap is within this many
+      // points, so the choice doesn't matter.
+      double tolerance = 0.01;
+      // Minimum number of samples before a hand can be decided.
+      int64_t min_count = 100;
+      // Maximum wall clock time for the simulation.
+      std::chrono::seconds budget = std::chrono::seconds::max();
+   };
+
+   // How the outcome of each simulated deal is evaluated.
+   enum class Mode : uint32_t {
+      // Score the hands against a single sampled starter.
+      sampled_starter,
+      // Average the outcome over every card left in the deck after the deal,
+      // so the starter adds no variance.
+      all_starters,
+      // Same as all_starters, but the observer's hand is scored with its
+      // exact expected value given the observer's six cards. This is a
+      // control variate: the expected value is known, so it removes the
+      // variance the opponent's cards add to the observer's hand. The
+      // expected values only depend on the class of the observer's hand, so
+      // they're computed once for every class and shared by all simulators.
+      control_variate
+   };
+
    DiscardSimulator(const DiscardTable& opponent,
-                    const HandVsHand& hvh) noexcept;
+                    const HandVsHand& hvh,
+                    Mode mode = Mode::sampled_starter) noexcept;
 
    // Simulate the hands. May be called multiple times to split up a long
-   // simulation into chunks.
+   // simulation into chunks. Each worker buffers its results locally, and the
+   // buffers are merged in a deterministic order, so no locking is required.
    void simulate(int64_t num_hands);
+   // Same as above, but stops early if every hand has been decided or the
+   // budget runs out. Returns the number of hands simulated.
+   int64_t simulate(int64_t num_hands, const StoppingRule& rule);
+
+   // Returns true if the best action for every hand is statistically
+   // separated from the runner-up.
+   bool is_decided(const StoppingRule& rule) const noexcept;
+
+   // If enabled, simulate(num_hands, rule) deals the observer's hand from a
+   // distribution that favors hands whose best action is still in doubt.
+   // Hands that have already been decided are still dealt occasionally, so
+   // every hand keeps being sampled. The distribution is updated every time
+   // the simulator checks whether it's done.
+   void set_importance_sampling(bool enabled) noexcept;
+
+   // Seeds the random number generators, so a simulation can be repeated
+   // exactly on a machine with the same number of threads. By default, they're
+   // seeded from std::random_device.
+   void set_seed(uint64_t seed) noexcept;
+
+   // Returns the number of hands simulated so far, including any hands loaded
+   // or merged from a file.
+   int64_t num_hands() const noexcept;
+
+   // While simulating, periodically save the results to the given file, so an
+   // interrupted simulation can be resumed with load().
+   void set_checkpoint(const char* filename, std::chrono::seconds interval);
 
    // Calculates the best response to the opponent's strategy. Return value is
-   // the exploitability of the opponent's strategy in points.
+   // the exploitability of the opponent's strategy in points. Each hand's
+   // result is weighted by how often it's dealt, not how often it was
+   // simulated, so this is unbiased even with importance sampling.
    double best_response(DiscardTable& response) const noexcept;
+   // Returns the mean net points scored by each action for the hand with the
+   // given canonical ordinal. Returns false if the hand hasn't been dealt.
+   using ActionPoints = std::array<double, num_discard_actions>;
+   bool mean_points(int ordinal,
+                    bool dealer,
+                    ActionPoints& points) const noexcept;
 
    // Load/save the simulation results from/to a file. Note: this doesn't
-   // preserve the DiscardTable or HandVsHand data.
+   // preserve the DiscardTable or HandVsHand data, but the file records which
+   // opponent strategy and mode were used, and load fails if they don't
+   // match.
    bool load(const char* filename);
    void save(const char* filename) const noexcept;
+   // Adds the results from a file to the current results. This allows a
+   // simulation to be split across independent processes and combined.
+   bool merge(const char* filename);
+   // Returns true if the file holds results simulated against the same
+   // opponent strategy and mode, i.e., it can be loaded or merged.
+   bool matches(const char* filename) const;
 
 private:
    // Tallies the points scored in a round of Cribbage.
@@ -51,24 +131,31 @@ private:
    // Accumulates statistics for a discard action.
    class ActionResult {
    public:
-      // Updates the statistics based on the given outcome.
-      void update(const PointsScored& points) noexcept;
+      // Updates the statistics based on the observer's net points.
+      void update(int observer_net) noexcept;
+      // Adds the statistics from another set of samples.
+      void merge(const ActionResult& other) noexcept;
 
       // Returns the total net points scored by the observer.
-      int observer_net_points() const noexcept;
+      int64_t observer_net_points() const noexcept;
+      // Returns the mean and standard error of the observer's net points
+      // given the number of samples.
+      double mean(int64_t count) const noexcept;
+      double std_error(int64_t count) const noexcept;
 
    private:
-      int observer_net_points_ = 0;
+      // Sums are 64-bit since a single simulation may deal billions of hands.
+      int64_t observer_net_points_ = 0;
+      int64_t observer_net_squares_ = 0;
    };
    using ActionResults = std::array<ActionResult, num_discard_actions>;
 
-   // Tracks the results for each discard action vs. a given hand. There are a
-   // large number of hands, so contention on a specific hand should be light;
-   // hence, we use a spinlock to serialize access.
+   // Tracks the results for each discard action vs. a given hand.
    struct State {
-      Spinlock lock;
-      int count = 0;
+      int64_t count = 0;
       ActionResults results;
+
+      void merge(const State& other) noexcept;
    };
    
    // Tracks the valid discard actions for a given hand and the results.
@@ -79,19 +166,150 @@ private:
       State pone;
    };
 
-   void simulate_worker(int64_t num_hands) noexcept;
+   // The parts of a deal's outcome that only depend on the observer's action
+   // and the starter. These are computed once per deal and shared by the
+   // dealer and pone evaluations.
+   struct ActionInfo {
+      int hand_points;
+      // Ordinal of the kept cards in the HandVsHand table.
+      int ordinal;
+      CardsDiscarded discarded;
+      // Crib scored incrementally, starting with the observer's discards.
+      HandScore crib{true};
+   };
+
+   // Outcome of a single simulated deal from the observer's perspective,
+   // multiplied by scale_.
+   struct Delta {
+      int ordinal;
+      bool dealer;
+      std::array<int32_t, num_discard_actions> observer_net;
+   };
+   // Deltas buffered by a single worker. The deltas are bucketed by the range
+   // of entries they update, so that each bucket can be merged independently.
+   using Shard = std::vector<std::vector<Delta>>;
+
+   // Number of hands each worker simulates before the shards are merged. This
+   // bounds the size of the shards.
+   static constexpr int64_t hands_per_batch = 1 << 16;
+   // Number of deals each worker canonizes at once.
+   static constexpr int deal_block_size = 64;
+
+   // How often to check whether every hand has been decided.
+   static constexpr std::chrono::seconds check_interval{60};
+
+   // Relative sampling weight of a hand whose best action has been decided.
+   static constexpr double decided_weight = 1.0 / 16.0;
+
+   // Number of possible starters after both hands are dealt ...
+   static constexpr int num_deck_starters =
+      num_cards_in_deck - (num_players * num_cards_dealt_per_player);
+   // ... and from the observer's point of view.
+   static constexpr int num_observer_starters =
+      num_cards_in_deck - num_cards_dealt_per_player;
+
+   // Header for the results file.
+   struct FileHeader {
+      uint32_t magic;
+      uint32_t version;
+      // Identifies the opponent strategy used for the simulation.
+      uint64_t opponent_id;
+      // Results from different modes have different scales.
+      uint64_t mode;
+   };
+   static constexpr uint32_t file_magic = 0x4d495344; // "DSIM"
+   static constexpr uint32_t file_version = 2;
+
+   // Simulates a single batch of hands and merges the results. Returns the
+   // number of hands simulated.
+   int64_t simulate_batch(int64_t max_hands, std::vector<Shard>& shards);
+
+   // Worker functions for each thread. If the simulator is seeded, each
+   // worker in each batch draws from its own stream of random numbers.
+   void simulate_worker(int64_t num_hands,
+                        uint64_t stream,
+                        Shard& shard) const noexcept;
+   void merge_worker(int bucket, std::vector<Shard>& shards) noexcept;
+
+   // Saves a checkpoint if one is due.
+   void checkpoint();
+   // Recomputes the distribution used to deal the observer's hand.
+   void update_sampling(const StoppingRule& rule);
+   // Deals the observer's hand from the sampling distribution and the rest
+   // of the cards at random.
+   void deal_weighted(Deck& deck,
+                      pcg32& rng,
+                      CardsDealt& opponent,
+                      CardsDealt& observer,
+                      Card& starter) const noexcept;
 
    // Find the best action given the simulated results. Returns the best action
    // and the number of points scored by the action.
-   static std::pair<int, int> find_best(const ActionResults& results) noexcept;
+   static std::pair<int, int64_t>
+   find_best(const ActionResults& results) noexcept;
+   // Returns the gap in points between the best action and the runner-up
+   // and the standard error of the gap. Actions equivalent to the best
+   // action have the same expected value, so they're never separated by
+   // simulating, and they can't be the runner-up.
+   static std::pair<double, double>
+   separation(const State& state,
+              const EquivalentActions& equivalent,
+              int scale) noexcept;
+   // Returns true if the best action is statistically separated from the
+   // runner-up, or the choice between them can't matter by more than the
+   // tolerance.
+   static bool is_decided(const State& state,
+                          const EquivalentActions& equivalent,
+                          const StoppingRule& rule,
+                          int scale) noexcept;
+   // Returns the relative weight for sampling more hands like the state's:
+   // 1 if the best action is in doubt, shrinking towards decided_weight as
+   // the gap to the runner-up grows beyond the margin of error. Hands whose
+   // actions are confidently within the tolerance of each other, i.e., the
+   // gap plus the margin of error is within the tolerance, get
+   // decided_weight.
+   static double sampling_weight(const State& state,
+                                 const EquivalentActions& equivalent,
+                                 const StoppingRule& rule,
+                                 int scale) noexcept;
+
+   // Entries for every possible equivalence class of hands, indexed by the
+   // canonical ordinal of the hand.
+   using EntryArray = std::vector<Entry>;
+
+   // Reads the entries from a results file. Fails if the file was generated
+   // against a different opponent.
+   bool read_entries(const char* filename, EntryArray& entries) const;
+   bool header_matches(const FileHeader& header) const noexcept;
+   // Computes a hash of the opponent's actions for every hand.
+   static uint64_t make_opponent_id(const DiscardTable& opponent) noexcept;
 
-    // Entries for every possible equivalence class of hands.
-   using MapType = std::unordered_map<uint64_t, Entry>;
-   MapType entries_;
+   EntryArray entries_;
    // Opponent strategy used for the simulation.
    const DiscardTable& opponent_;
    // Used to lookup the card play value of the kept cards.
    const HandVsHand& hvh_;
+   // Identifies the opponent strategy in results files, so results generated
+   // against different strategies aren't mixed.
+   uint64_t opponent_id_;
+   Mode mode_;
+   // Recorded outcomes are the net points multiplied by scale_, so they're
+   // always integers. Points summed over the starters are multiplied by
+   // term_weight_ to bring them to the same scale.
+   int scale_;
+   int term_weight_;
+   bool importance_sampling_ = false;
+   bool seeded_ = false;
+   uint64_t seed_ = 0;
+   // Next stream of random numbers to hand out to a worker.
+   uint64_t next_stream_ = 0;
+   // Cumulative sampling weights of the hands indexed by canonical ordinal.
+   // Empty if hands are dealt uniformly.
+   std::vector<double> sampling_cdf_;
+   // Checkpoint file or empty if checkpoints are disabled.
+   std::string checkpoint_file_;
+   std::chrono::seconds checkpoint_interval_{0};
+   std::chrono::steady_clock::time_point last_checkpoint_;
 };
 
 #endif /* DiscardSimulator_h */
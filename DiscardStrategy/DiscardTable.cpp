@@ -9,7 +9,14 @@
 #include "Canonize.h"
 #include "CardSplitter.h"
 #include "FileIo.h"
+#include "FlatMap.h"
 #include "Score.h"
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 void DiscardTable::format_actions(std::ostream& out,
                                          const CardsDealt& cards) const noexcept
@@ -45,41 +52,114 @@ void DiscardTable::format_actions(std::ostream& out,
 }
 
 bool DiscardTable::load(const char* filename)
+{
+   return map_file(filename) || load_legacy(filename);
+}
+
+void DiscardTable::save(const char* filename) const noexcept
+{
+   std::ofstream ostrm(filename, std::ios::binary | std::ios::trunc);
+   FileHeader header = { file_magic, file_version, num_canonical_hands };
+   write_pod(ostrm, header);
+   if (actions_) {
+      ostrm.write(reinterpret_cast<const char*>(actions_.get()),
+                  num_canonical_hands);
+   } else {
+      std::vector<char> empty(num_canonical_hands, undefined);
+      ostrm.write(empty.data(), empty.size());
+   }
+}
+
+void DiscardTable::insert(uint64_t key, int dealer_action, int pone_action)
+{
+   assert((dealer_action >= 0) && (dealer_action < num_discard_actions));
+   assert((pone_action >= 0) && (pone_action < num_discard_actions));
+   make_writable();
+   actions_.get()[canonical_ordinal(key)] =
+      static_cast<uint8_t>(dealer_action | (pone_action << action_bits));
+}
+
+bool DiscardTable::map_file(const char* filename)
+{
+   constexpr auto file_size = sizeof(FileHeader) + num_canonical_hands;
+
+   auto fd = open(filename, O_RDONLY);
+   if (fd == -1) {
+      return false;
+   }
+   struct stat info;
+   if ((fstat(fd, &info) != 0) || (static_cast<size_t>(info.st_size) != file_size)) {
+      close(fd);
+      return false;
+   }
+   auto addr = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+   // The mapping remains valid after the file is closed.
+   close(fd);
+   if (addr == MAP_FAILED) {
+      return false;
+   }
+
+   // The mapping is released when the last table referring to it goes away.
+   std::shared_ptr<uint8_t> region(static_cast<uint8_t*>(addr),
+                                   [file_size](uint8_t* p) {
+      munmap(p, file_size);
+   });
+   FileHeader header;
+   std::memcpy(&header, region.get(), sizeof(header));
+   if ((header.magic != file_magic) ||
+       (header.version != file_version) ||
+       (header.num_entries != num_canonical_hands)) {
+      return false;
+   }
+
+   actions_ = std::shared_ptr<uint8_t>(region, region.get() + sizeof(header));
+   mapped_ = true;
+   return true;
+}
+
+bool DiscardTable::load_legacy(const char* filename)
 {
    std::ifstream istrm(filename, std::ios::binary);
    if (!istrm.is_open()) {
       return false;
    }
-   MapType tmp;
+   FlatMap<uint64_t, Actions> tmp;
    if (!read_pod_map(istrm, tmp)) {
       return false;
    }
    if (!read_complete(istrm)) {
       return false;
    }
-   strategy_.swap(tmp);
+   clear();
+   for (const auto& [key, actions] : tmp) {
+      insert(key, actions.dealer, actions.pone);
+   }
    return true;
 }
 
-void DiscardTable::save(const char* filename) const noexcept
+void DiscardTable::make_writable()
 {
-   std::ofstream ostrm(filename, std::ios::binary | std::ios::trunc);
-   write_pod_map(ostrm, strategy_);
-}
-
-void DiscardTable::insert(uint64_t key, int dealer_action, int pone_action)
-{
-    strategy_[key] = { dealer_action, pone_action };
+   if (actions_ && !mapped_ && (actions_.use_count() == 1)) {
+      return;
+   }
+   std::shared_ptr<uint8_t> tmp(new uint8_t[num_canonical_hands],
+                                std::default_delete<uint8_t[]>());
+   if (actions_) {
+      std::memcpy(tmp.get(), actions_.get(), num_canonical_hands);
+   } else {
+      std::memset(tmp.get(), undefined, num_canonical_hands);
+   }
+   actions_ = tmp;
+   mapped_ = false;
 }
 
 DiscardTable generate_greedy_strategy()
 {
-   DiscardTable dst;
-   generate_cards_dealt([&dst](auto& cards) {
-      auto key = canonize(cards);
-      if (dst.contains(key)) { return; }
-
-      CardSplitter splitter(cards);
+   // Each class is evaluated independently, so the work is split between
+   // threads, and the results are inserted into the table afterwards.
+   std::vector<DiscardTable::Actions> actions(num_canonical_hands);
+   generate_canonical_hands([&actions](const CanonicalHand& canonical) {
+      CardSplitter splitter(canonical.cards);
 
       auto max_dealer_points = -1;
       auto best_dealer_action = 0;
@@ -110,8 +190,12 @@ DiscardTable generate_greedy_strategy()
          }
       } while (splitter.next());
 
-      dst.insert(key, best_dealer_action, best_pone_action);
+      actions[canonical.ordinal] = { best_dealer_action, best_pone_action };
    });
 
+   DiscardTable dst;
+   for (auto i = 0; i < num_canonical_hands; ++i) {
+      dst.insert(canonical_key(i), actions[i].dealer, actions[i].pone);
+   }
    return dst;
 }
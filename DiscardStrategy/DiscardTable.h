@@ -8,13 +8,21 @@
 #ifndef DiscardTable_h
 #define DiscardTable_h
 
+#include "Canonize.h"
 #include "Card.h"
+#include "DiscardDefs.h"
 #include <cstdint>
 #include <iostream>
-#include <unordered_map>
+#include <memory>
 
 // Represents a pure strategy for selecting which cards to discard from a
 // cribbage hand where the action is determined from a table lookup.
+//
+// The table stores one byte per equivalence class, indexed by canonical
+// ordinal. Tables loaded from a file are memory-mapped read-only, so loading
+// is nearly instant and the pages are shared by every table mapping the same
+// file, even across processes. Copies share the same storage until one of
+// them is modified.
 class DiscardTable
 {
 public:
@@ -35,7 +43,8 @@ public:
    void format_actions(std::ostream& out,
                        const CardsDealt& cards) const noexcept;
 
-   // Load/save the strategy from/to a file.
+   // Load/save the strategy from/to a file. load also accepts files in the
+   // legacy map format, but these must be read into memory.
    bool load(const char* filename);
    void save(const char* filename) const noexcept;
 
@@ -47,57 +56,57 @@ public:
    void insert(uint64_t key, int dealer_action, int pone_action);
 
 private:
-   using MapType = std::unordered_map<uint64_t, Actions>;
-   MapType strategy_;
+   // Actions are packed into a byte with the dealer action in the low bits.
+   static constexpr int action_bits = 4;
+   static_assert(num_discard_actions < (1 << action_bits));
+   // An action of all ones marks an entry that hasn't been defined.
+   static constexpr uint8_t undefined = 0xff;
+
+   // Header for the table file.
+   struct FileHeader {
+      uint32_t magic;
+      uint32_t version;
+      uint64_t num_entries;
+   };
+   static constexpr uint32_t file_magic = 0x4c424454; // "TDBL"
+   static constexpr uint32_t file_version = 1;
+
+   // Memory maps a file in the current format.
+   bool map_file(const char* filename);
+   // Reads a file in the legacy map format.
+   bool load_legacy(const char* filename);
+   // Makes sure the table has private, writable storage.
+   void make_writable();
+
+   // Packed actions for each class or null if the table is empty.
+   std::shared_ptr<uint8_t> actions_;
+   // True if actions_ points to a read-only file mapping.
+   bool mapped_ = false;
 };
 
 inline DiscardTable::Actions DiscardTable::find(uint64_t key) const noexcept
 {
-   auto i = strategy_.find(key);
-   assert(i != strategy_.end());
-   return i->second;
+   assert(contains(key));
+   auto packed = actions_.get()[canonical_ordinal(key)];
+   return {
+      packed & ((1 << action_bits) - 1),
+      packed >> action_bits
+   };
 }
 
 inline bool DiscardTable::contains(uint64_t key) const noexcept
 {
-   return strategy_.find(key) != strategy_.end();
+   return actions_ && (actions_.get()[canonical_ordinal(key)] != undefined);
 }
 
 inline void DiscardTable::clear() noexcept
 {
-   strategy_.clear();
+   actions_.reset();
+   mapped_ = false;
 }
 
 // Generate a greedy discard strategy, i.e., a strategy that maximizes the
 // number of guaranteed points.
 DiscardTable generate_greedy_strategy();
 
-// Invokes Fn for every possible combination of cards dealt.
-template<typename Fn>
-void generate_cards_dealt(Fn fn) noexcept
-{
-   // It's way easier to hardcode this for a standard Cribbage game than to
-   // handle all possibilities.
-   static_assert(num_cards_in_deck == 52);
-   static_assert(num_cards_dealt_per_player == 6);
-
-   for (auto i0 = 0; i0 < 52; ++i0) {
-      for (auto i1 = i0 + 1; i1 < 52; ++i1) {
-         for (auto i2 = i1 + 1; i2 < 52; ++i2) {
-            for (auto i3 = i2 + 1; i3 < 52; ++i3) {
-               for (auto i4 = i3 + 1; i4 < 52; ++i4) {
-                  for (auto i5 = i4 + 1; i5 < 52; ++i5) {
-                     CardsDealt cards = {
-                        Card(i0), Card(i1), Card(i2),
-                        Card(i3), Card(i4), Card(i5)
-                     };
-                     fn(cards);
-                 }
-               }
-            }
-         }
-      }
-   }
-}
-
 #endif /* DiscardTable_h */
@@ -0,0 +1,155 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#include "FictitiousPlay.h"
+#include "Canonize.h"
+#include "FileIo.h"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+int FictitiousPlay::State::best_response() const noexcept
+{
+   if (num_values == 0) {
+      // Nothing is known about the hand, so keep playing the same action.
+      return action;
+   }
+   auto i = std::max_element(values.begin(), values.end());
+   return static_cast<int>(std::distance(values.begin(), i));
+}
+
+int FictitiousPlay::State::most_played() const noexcept
+{
+   // Break ties in favor of the latest best response, since it's based on
+   // the most results.
+   auto i = std::max_element(plays.begin(), plays.end());
+   if (plays[action] == *i) {
+      return action;
+   }
+   return static_cast<int>(std::distance(plays.begin(), i));
+}
+
+FictitiousPlay::FictitiousPlay(const DiscardTable& initial)
+: entries_(num_canonical_hands)
+{
+   for (auto i = 0; i < num_canonical_hands; ++i) {
+      auto actions = initial.find(canonical_key(i));
+      auto& entry = entries_[i];
+      entry.dealer.action = static_cast<uint8_t>(actions.dealer);
+      entry.pone.action = static_cast<uint8_t>(actions.pone);
+      ++entry.dealer.plays[actions.dealer];
+      ++entry.pone.plays[actions.pone];
+   }
+}
+
+DiscardTable FictitiousPlay::current() const
+{
+   DiscardTable result;
+   for (auto i = 0; i < num_canonical_hands; ++i) {
+      const auto& entry = entries_[i];
+      result.insert(canonical_key(i), entry.dealer.action, entry.pone.action);
+   }
+   return result;
+}
+
+DiscardTable FictitiousPlay::average() const
+{
+   DiscardTable result;
+   for (auto i = 0; i < num_canonical_hands; ++i) {
+      const auto& entry = entries_[i];
+      result.insert(canonical_key(i),
+                    entry.dealer.most_played(),
+                    entry.pone.most_played());
+   }
+   return result;
+}
+
+double FictitiousPlay::update(const DiscardSimulator& simulator)
+{
+   return update([&simulator](int ordinal, bool dealer, ActionPoints& points) {
+      return simulator.mean_points(ordinal, dealer, points);
+   }, simulator.num_hands());
+}
+
+double FictitiousPlay::update(const MeanPoints& mean_points,
+                              int64_t num_hands)
+{
+   assert(num_iterations_ < std::numeric_limits<uint16_t>::max());
+
+   auto points_sum = 0.0;
+   int64_t weight_sum = 0;
+   ActionPoints points;
+   for (auto i = 0; i < num_canonical_hands; ++i) {
+      auto& entry = entries_[i];
+      for (auto dealer : { false, true }) {
+         auto& state = dealer ? entry.dealer : entry.pone;
+         if (mean_points(i, dealer, points)) {
+            // Incremental mean, so every iteration gets the same weight.
+            ++state.num_values;
+            for (auto a = 0; a < num_discard_actions; ++a) {
+               state.values[a] += static_cast<float>(
+                  (points[a] - state.values[a]) / state.num_values
+               );
+            }
+         }
+         state.action = static_cast<uint8_t>(state.best_response());
+         ++state.plays[state.action];
+      }
+
+      // The best response is worth the same to the observer as it costs the
+      // average strategy.
+      if ((entry.dealer.num_values > 0) && (entry.pone.num_values > 0)) {
+         auto weight = canonical_weight(canonical_key(i));
+         points_sum += (entry.dealer.values[entry.dealer.action] +
+                        entry.pone.values[entry.pone.action]) * weight / 2.0;
+         weight_sum += weight;
+      }
+   }
+   ++num_iterations_;
+   num_hands_ += num_hands;
+
+   return (weight_sum > 0) ? (points_sum / weight_sum) : 0.0;
+}
+
+bool FictitiousPlay::load(const char* filename)
+{
+   std::ifstream istrm(filename, std::ios::binary);
+   if (!istrm.is_open()) {
+      return false;
+   }
+   FileHeader header;
+   if (!read_pod(istrm, header)) {
+      return false;
+   }
+   if ((header.magic != file_magic) || (header.version != file_version)) {
+      return false;
+   }
+   std::vector<Entry> tmp;
+   if (!read_pod_vector(istrm, tmp)) {
+      return false;
+   }
+   if (tmp.size() != num_canonical_hands) {
+      return false;
+   }
+   if (!read_complete(istrm)) {
+      return false;
+   }
+   entries_.swap(tmp);
+   num_iterations_ = static_cast<int>(header.num_iterations);
+   num_hands_ = header.num_hands;
+   return true;
+}
+
+void FictitiousPlay::save(const char* filename) const noexcept
+{
+   std::ofstream ostrm(filename, std::ios::binary | std::ios::trunc);
+   write_pod(ostrm, FileHeader{ file_magic,
+                                file_version,
+                                num_iterations_,
+                                num_hands_ });
+   write_pod_vector(ostrm, entries_);
+}
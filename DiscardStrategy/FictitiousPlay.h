@@ -0,0 +1,115 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#ifndef FictitiousPlay_h
+#define FictitiousPlay_h
+
+#include "DiscardDefs.h"
+#include "DiscardSimulator.h"
+#include "DiscardTable.h"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Solves for a discard strategy using fictitious play. Each iteration plays
+// the best response to the average of every strategy played so far, so the
+// average converges instead of oscillating between strategies the way
+// repeated best responses can.
+//
+// Net points are linear in the opponent's mixed strategy, so the value of an
+// action vs. the average strategy is the average of its values vs. each of
+// the strategies. Each iteration only needs to simulate against the latest
+// strategy, and the results of earlier iterations are never discarded.
+class FictitiousPlay
+{
+public:
+   explicit FictitiousPlay(const DiscardTable& initial);
+
+   // Number of strategies in the average so far.
+   int num_iterations() const noexcept;
+   // Total number of hands simulated across all iterations.
+   int64_t num_hands() const noexcept;
+
+   // Returns the latest strategy, which is the one to simulate against next.
+   DiscardTable current() const;
+   // Returns the pure strategy closest to the average, i.e., the action played
+   // most often for each hand.
+   DiscardTable average() const;
+
+   // Folds in the results simulated against current() and makes the best
+   // response to the average the new current strategy. Return value is an
+   // estimate of the exploitability in points of the mixed average strategy,
+   // i.e., the one that plays each action as often as it's been played. It's
+   // not the exploitability of the pure strategy returned by average().
+   double update(const DiscardSimulator& simulator);
+   // Same as above, but the results come from any source. mean_points has
+   // the same semantics as DiscardSimulator::mean_points, and num_hands is
+   // the number of hands the results are based on.
+   using ActionPoints = DiscardSimulator::ActionPoints;
+   using MeanPoints =
+      std::function<bool(int ordinal, bool dealer, ActionPoints& points)>;
+   double update(const MeanPoints& mean_points, int64_t num_hands);
+
+   // Load/save the solver state from/to a file, so a long solve can be
+   // resumed.
+   bool load(const char* filename);
+   void save(const char* filename) const noexcept;
+
+private:
+   // Tracks the average strategy and action values for a hand in one role.
+   struct State {
+      // Number of iterations whose results include the hand. A hand may be
+      // missing from a short simulation, in which case the average values
+      // only cover the iterations that dealt it.
+      uint32_t num_values = 0;
+      // Number of times each action has been played.
+      std::array<uint16_t, num_discard_actions> plays{};
+      // Action played by the current strategy.
+      uint8_t action = 0;
+      // Average net points scored by each action.
+      std::array<float, num_discard_actions> values{};
+
+      // Returns the action with the highest value.
+      int best_response() const noexcept;
+      // Returns the action played most often.
+      int most_played() const noexcept;
+   };
+
+   struct Entry {
+      State dealer;
+      State pone;
+   };
+
+   // Header for the solver file.
+   struct FileHeader {
+      uint32_t magic;
+      uint32_t version;
+      int64_t num_iterations;
+      int64_t num_hands;
+   };
+   static constexpr uint32_t file_magic = 0x594c5046; // "FPLY"
+   static constexpr uint32_t file_version = 1;
+
+   // Entries for every equivalence class of hands, indexed by the canonical
+   // ordinal of the hand.
+   std::vector<Entry> entries_;
+   int num_iterations_ = 1;
+   int64_t num_hands_ = 0;
+};
+
+inline int FictitiousPlay::num_iterations() const noexcept
+{
+   return num_iterations_;
+}
+
+inline int64_t FictitiousPlay::num_hands() const noexcept
+{
+   return num_hands_;
+}
+
+#endif /* FictitiousPlay_h */
@@ -22,10 +22,10 @@ using Rank = char;
 
 // In cribbage, all face cards count as 10, so a card's value is not
 // necessarily the same as its rank.
-int rank_value(Rank rank) noexcept;
+constexpr int rank_value(Rank rank) noexcept;
 
 // Useful for indexing into an array when storing state about each rank.
-int rank_ordinal(Rank rank) noexcept;
+constexpr int rank_ordinal(Rank rank) noexcept;
 
 bool rank_is_valid(Rank rank) noexcept;
 
@@ -104,12 +104,12 @@ inline bool operator!=(const Card& lhs, const Card& rhs) noexcept
    return !operator==(lhs, rhs);
 }
 
-inline int rank_value(Rank rank) noexcept
+inline constexpr int rank_value(Rank rank) noexcept
 {
    return std::min<int>(rank, max_card_value);
 }
 
-inline int rank_ordinal(Rank rank) noexcept
+inline constexpr int rank_ordinal(Rank rank) noexcept
 {
    return rank - min_card_rank;
 }
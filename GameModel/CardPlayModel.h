@@ -22,7 +22,13 @@ public:
    bool is_legal_play(Rank rank) const noexcept;
    // Not the # of cards, but the count of the cards' values.
    int count() const noexcept;
+   // Number of cards played so far in the round.
+   int cards_played() const noexcept;
    bool round_over() const noexcept;
+   // Uniquely identifies the state of the current series and the player to
+   // move. Together with the cards left in each hand, this determines how
+   // the rest of the round can play out.
+   uint32_t key() const noexcept;
 
    // Plays the card for the current player and returns the number of points
    // scored.
@@ -73,11 +79,25 @@ inline int CardPlayModel::count() const noexcept
    return count_;
 }
 
+inline int CardPlayModel::cards_played() const noexcept
+{
+   return cards_played_;
+}
+
 inline bool CardPlayModel::round_over() const noexcept
 {
    return cards_played_ == max_cards_in_play;
 }
 
+inline uint32_t CardPlayModel::key() const noexcept
+{
+   uint32_t result = score_.state();
+   result = (result << 5) | count_;
+   result = (result << 1) | current_;
+   result = (result << 1) | go_announced_;
+   return result;
+}
+
 inline void CardPlayModel::next_player() noexcept
 {
    current_ = ::next_player(current_);
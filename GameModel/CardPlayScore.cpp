@@ -6,99 +6,183 @@
 //
 
 #include "CardPlayScore.h"
-#include "FileIo.h"
-#include "Score.h"
+#include "FlatMap.h"
+#include <map>
+#include <numeric>
 
-const CardPlayScores::ScoreMap& CardPlayScores::get()
+namespace {
+
+// Everything about a series that can affect future points. Used to generate
+// the states of the automaton.
+struct Series
 {
-   static CardPlayScores scores;
-   return scores.scores_;
-}
+   // Uniquely identifies the series.
+   uint64_t key() const noexcept;
+   bool is_legal_play(Rank rank) const noexcept;
+   // Plays the rank and returns the number of points scored.
+   int play(Rank rank) noexcept;
 
-CardPlayScores::ScoreNode::ScoreNode() noexcept
+   int count = 0;
+   // Number of trailing cards with the same rank.
+   int match_len = 0;
+   // Trailing distinct ranks, most recent first. Once a rank can no longer be
+   // part of a run, it's dropped, so equivalent series have the same ranks.
+   SizedArray<Rank, max_cards_in_play> ranks;
+};
+
+uint64_t Series::key() const noexcept
 {
-   remaining.fill(num_card_suits);
+   uint64_t result = count;
+   result = (result << 4) | match_len;
+   for (auto rank : ranks) {
+      result = (result << 4) | rank;
+   }
+   return result;
 }
 
-bool CardPlayScores::ScoreNode::try_push(int rank) noexcept
+bool Series::is_legal_play(Rank rank) const noexcept
 {
-   // Suits don't count during card play, so pick any.
-   Card card(rank, 1);
-   // Can only play the card if all the following are true:
-   //   1) It won't push the count over 31.
-   //   2) There's at least one card of that rank remaining in the deck.
-   //   3) All the cards for the round haven't already been played.
-   if (((card.value() + count) > max_count_in_play) ||
-       (remaining[card.rank() - min_card_rank] == 0) ||
-       (cards.size() == cards.capacity())) {
+   if ((count + rank_value(rank)) > max_count_in_play) {
       return false;
    }
-
-   // Now that we know the push will succeed, update all our state.
-   key.push_back(card.rank());
-   count += card.value();
-   --remaining[card.rank() - min_card_rank];
-   cards.push_back(card);
-   return true;
+   // Can't play more cards of a rank than there are suits.
+   return (ranks.empty() || (ranks[0] != rank) || (match_len < num_card_suits));
 }
 
-void CardPlayScores::ScoreNode::pop() noexcept
+int Series::play(Rank rank) noexcept
 {
-   // Undo everything we did in the previous function.
-   assert(!cards.empty());
-   auto card = cards.back();
-   cards.pop_back();
-   ++remaining[card.rank() - min_card_rank];
-   count -= card.value();
-   key.pop_back();
-}
+   count += rank_value(rank);
+   match_len = (!ranks.empty() && (ranks[0] == rank)) ? match_len + 1 : 1;
 
-CardPlayScores::CardPlayScores()
-{
-   if (!load()) {
-      // If we can't load the cached table, build a new one and save it.
-      ScoreNode root;
-      evaluate(root);
-      save();
+   // A run can't contain two cards of the same rank, so only the ranks played
+   // since the last card of this rank matter.
+   decltype(ranks) window;
+   window.push_back(rank);
+   for (auto r : ranks) {
+      if ((r == rank) || (window.size() == window.capacity())) {
+         break;
+      }
+      window.push_back(r);
    }
-}
 
+   auto points = match_len * (match_len - 1);
 
-void CardPlayScores::evaluate(ScoreNode& node)
-{
-   // Process this node.
-   scores_[node.key()] = score_cards_in_play(node.cards.begin(),
-                                             node.cards.end(),
-                                             node.count);;
-   // Then traverse all the children.
-   for (auto i = min_card_rank; i <= max_card_rank; ++i) {
-      if (node.try_push(i)) {
-         evaluate(node);
-         node.pop();
+   // Find the longest run and the longest prefix of the window that could
+   // still become a run if the gaps are filled without exceeding 31.
+   auto run_len = 0;
+   auto live_len = 1;
+   auto min_rank = rank;
+   auto max_rank = rank;
+   auto ranks_seen = 1u << rank;
+   for (auto len = 2; len <= window.size(); ++len) {
+      auto r = window[len - 1];
+      ranks_seen |= 1u << r;
+      min_rank = std::min(min_rank, r);
+      max_rank = std::max(max_rank, r);
+      if (len == (max_rank - min_rank + 1)) {
+         run_len = len;
+      }
+      auto gap_value = 0;
+      for (auto gap = min_rank; gap <= max_rank; ++gap) {
+         if ((ranks_seen & (1u << gap)) == 0) {
+            gap_value += rank_value(gap);
+         }
+      }
+      if ((count + gap_value) <= max_count_in_play) {
+         live_len = len;
       }
    }
-}
 
-bool CardPlayScores::load() noexcept
-{
-   std::ifstream istrm(filename, std::ios::binary);
-   if (!istrm.is_open()) {
-      return false;
+   // Run must be at least 3 cards long to count.
+   if (run_len >= 3) {
+      points += run_len;
    }
-   ScoreMap tmp;
-   if (!read_pod_map(istrm, tmp)) {
-      return false;
-   }
-   if (!read_complete(istrm)) {
-      return false;
+
+   if (count == 15) {
+      points += num_points_for_15;
+   } else if (count == max_count_in_play) {
+      points += num_points_for_31;
    }
-   scores_.swap(tmp);
-   return true;
 
+   window.resize(live_len);
+   ranks = window;
+   return points;
 }
 
-void CardPlayScores::save() const noexcept
+} // namespace
+
+const CardPlayAutomaton::Row CardPlayAutomaton::table_[num_states] = {
+#include "CardPlayTransitions.inc"
+};
+
+std::vector<CardPlayAutomaton::Row> CardPlayAutomaton::build()
 {
-   std::ofstream ostrm(filename, std::ios::binary | std::ios::trunc);
-   write_pod_map(ostrm, scores_);
+   // Transition to a raw state or -1 if the play is illegal.
+   using Edge = std::pair<int, int>;
+   using Edges = std::array<Edge, num_card_ranks>;
+
+   // Enumerate every reachable series.
+   std::vector<Series> series(1);
+   std::vector<Edges> edges;
+   FlatMap<uint64_t, int> index;
+   index[series[0].key()] = 0;
+   for (auto i = 0; i < series.size(); ++i) {
+      Edges out;
+      for (Rank rank = min_card_rank; rank <= max_card_rank; ++rank) {
+         auto& edge = out[rank_ordinal(rank)];
+         if (!series[i].is_legal_play(rank)) {
+            edge = { -1, illegal };
+            continue;
+         }
+         auto next = series[i];
+         auto points = next.play(rank);
+         auto id = static_cast<int>(series.size());
+         if (!index.insert({ next.key(), id })) {
+            id = index.find(next.key())->second;
+         } else {
+            series.push_back(next);
+         }
+         edge = { id, points };
+      }
+      edges.push_back(out);
+   }
+
+   // Every play increases the count, so the series form a DAG. Visiting them
+   // in order of decreasing count, two series are equivalent if and only if
+   // their transitions are equivalent, which yields the minimal automaton.
+   std::vector<int> order(series.size());
+   std::iota(order.begin(), order.end(), 0);
+   std::stable_sort(order.begin(), order.end(), [&series](auto lhs, auto rhs) {
+      return series[lhs].count > series[rhs].count;
+   });
+
+   std::vector<int> classes(series.size());
+   std::map<Edges, int> signatures;
+   for (auto i : order) {
+      auto signature = edges[i];
+      for (auto& edge : signature) {
+         if (edge.first >= 0) {
+            edge.first = classes[edge.first];
+         }
+      }
+      classes[i] = signatures.insert({ signature, signatures.size() })
+                      .first->second;
+   }
+   assert(signatures.size() <= UINT16_MAX);
+
+   // The empty series has the only zero count, so it's the last class
+   // created. Number the states in reverse, so it becomes the start state.
+   auto num_classes = static_cast<int>(signatures.size());
+   assert(classes[0] == num_classes - 1);
+   std::vector<Row> table(num_classes);
+   for (auto& [signature, id] : signatures) {
+      auto& row = table[num_classes - 1 - id];
+      for (auto i = 0; i < num_card_ranks; ++i) {
+         auto [next, points] = signature[i];
+         row[i].next = (next >= 0) ? static_cast<State>(num_classes - 1 - next)
+                                   : start;
+         row[i].points = static_cast<uint8_t>(points);
+      }
+   }
+   return table;
 }
@@ -9,57 +9,51 @@
 #define CardPlayScore_h
 
 #include "Card.h"
-#include "RankKeys.h"
 #include <array>
+#include <cassert>
 #include <cstdint>
-#include <unordered_map>
+#include <vector>
 
-// Creates a map of all possible card series to their corresponding point
-// values.
-class CardPlayScores
+// Finite automaton that scores card play one rank at a time. A state captures
+// everything about the series that can affect future points: the count, the
+// length of the trailing pair, and the trailing ranks that could still be part
+// of a run. Transitions are stored in a dense table, so scoring a play is a
+// single lookup with no hashing.
+//
+// The table is generated ahead of time by build() and compiled in from
+// CardPlayTransitions.inc, so there's nothing to construct at runtime.
+class CardPlayAutomaton
 {
 public:
-   using ScoreMap = std::unordered_map<OrderedRanksKey::KeyType, int>;
-
-   // Creating the map is expensive, so everyone shares a read-only singleton.
-   static const ScoreMap& get();
-
-private:
-   static constexpr char filename[] = "card_play_scores.dat";
+   using State = uint16_t;
 
-   // Used during initialization to traverse the tree of all possible series.
-   struct ScoreNode
+   struct Transition
    {
-      ScoreNode() noexcept;
-      // Return false if a card of that rank can't be played.
-      bool try_push(int rank) noexcept;
-      // Undoes a successful call to try_push.
-      void pop() noexcept;
-
-      // Unique key identifying the sequence of cards.
-      OrderedRanksKey key;
-      // Current count.
-      int count = 0;
-      // Number of cards of each rank remaining.
-      std::array<int, num_card_ranks> remaining;
-      // All cards played so far.
-      CardsInPlay cards;
+      State next;
+      uint8_t points;
    };
+   using Row = std::array<Transition, num_card_ranks>;
 
-   // Constructor is private since this is a singleton.
-   CardPlayScores();
-   // Called recursively during initialization to traverse the tree.
-   void evaluate(ScoreNode& node);
-   // Load/save the map state to a file.
-   bool load() noexcept;
-   void save() const noexcept;
+   // State of an empty series.
+   static constexpr State start = 0;
+   // Number of states in the minimal automaton.
+   static constexpr int num_states = 22'497;
+   // Marks transitions for illegal plays.
+   static constexpr uint8_t illegal = UINT8_MAX;
 
-   ScoreMap scores_;
+   // The play must be legal, i.e., it can't push the count over 31.
+   static Transition next(State state, Rank rank) noexcept;
+
+   // Builds the transition table from scratch. Only needed to generate or
+   // verify CardPlayTransitions.inc.
+   static std::vector<Row> build();
+
+private:
+   static const Row table_[num_states];
 };
 
-// Scores a card series using a cached lookup, rather than starting from
-// scratch. Also supports incremental update, which is useful when traversing
-// game trees.
+// Scores a card series one play at a time. Also supports incremental update,
+// which is useful when traversing game trees.
 class CardPlayScore
 {
 public:
@@ -67,24 +61,44 @@ public:
    void update(int rank) noexcept;
    int score() const noexcept;
    int update_and_score(int rank) noexcept;
+   // State of the automaton. Two series in the same state score identically
+   // from here on.
+   CardPlayAutomaton::State state() const noexcept;
 
 private:
-   OrderedRanksKey key_;
+   CardPlayAutomaton::State state_ = CardPlayAutomaton::start;
+   // Points scored by the most recent play.
+   uint8_t points_ = 0;
 };
 
+inline CardPlayAutomaton::Transition CardPlayAutomaton::next(
+   State state,
+   Rank rank
+) noexcept
+{
+   assert(state < num_states);
+   assert(rank_is_valid(rank));
+   auto result = table_[state][rank_ordinal(rank)];
+   assert(result.points != illegal);
+   return result;
+}
+
 inline void CardPlayScore::clear() noexcept
 {
-   key_.clear();
+   state_ = CardPlayAutomaton::start;
+   points_ = 0;
 }
 
 inline void CardPlayScore::update(int rank) noexcept
 {
-   key_.push_back(rank);
+   auto transition = CardPlayAutomaton::next(state_, rank);
+   state_ = transition.next;
+   points_ = transition.points;
 }
 
 inline int CardPlayScore::score() const noexcept
 {
-   return CardPlayScores::get().find(key_())->second;
+   return points_;
 }
 
 inline int CardPlayScore::update_and_score(int rank) noexcept
@@ -93,4 +107,9 @@ inline int CardPlayScore::update_and_score(int rank) noexcept
    return score();
 }
 
+inline CardPlayAutomaton::State CardPlayScore::state() const noexcept
+{
+   return state_;
+}
+
 #endif /* CardPlayScore_h */
@@ -10,7 +10,11 @@
 #include <random>
 
 Deck::Deck() noexcept
-: rng_(pcg_extras::seed_seq_from<std::random_device>())
+: Deck(pcg32(pcg_extras::seed_seq_from<std::random_device>()))
+{ }
+
+Deck::Deck(const pcg32& rng) noexcept
+: rng_(rng)
 {
    cards_.resize(num_cards_in_deck);
    std::generate(cards_.begin(),
@@ -18,6 +18,9 @@ class Deck
 {
 public:
    Deck() noexcept;
+   // Shuffles with the given generator instead of a randomly seeded one, so
+   // the deals can be reproduced.
+   explicit Deck(const pcg32& rng) noexcept;
    Deck(const Deck& other) noexcept;
    Deck& operator=(const Deck& rhs) noexcept;
 
@@ -6,64 +6,173 @@
 //
 
 #include "HandScore.h"
-#include "Score.h"
 
+// A hand plus starter is five cards.
+constexpr int num_suitless_cards = num_cards_in_hand + 1;
 
-const SuitlessScores::ScoreMap& SuitlessScores::get() noexcept
+// Partial hand used to generate the SuitlessScores table at compile time.
+// Fifteens and pairs are tracked as cards are added, so each hand only pays
+// for scoring runs.
+struct SuitlessHand
 {
-   static SuitlessScores scores;
-   return scores.scores_;
-
+   // Number of ways to make each subtotal on the way to fifteen.
+   std::array<int, 16> ways = { 1 };
+   // Number of cards of each rank.
+   std::array<int, max_card_rank + 2> counts{};
+   int pair_points = 0;
+   int size = 0;
+
+   constexpr SuitlessHand add(Rank rank) const noexcept;
+   constexpr int score() const noexcept;
+};
+
+constexpr SuitlessHand SuitlessHand::add(Rank rank) const noexcept
+{
+   SuitlessHand result(*this);
+   auto value = rank_value(rank);
+   for (auto i = 15; i >= value; --i) {
+      result.ways[i] += result.ways[i - value];
+   }
+   result.pair_points += 2 * result.counts[rank];
+   ++result.counts[rank];
+   ++result.size;
+   return result;
 }
 
-SuitlessScores::SuitlessScores()
+constexpr int SuitlessHand::score() const noexcept
 {
-   // It's much easier to hardcode the nested for-loops than to do something
-   // clever that can handle all possibilities.
-   static_assert(num_cards == 5);
-   static_assert(min_card_suit == 1);
-   static_assert(max_card_suit == 4);
-   static_assert(min_card_rank == 1);
-   static_assert(max_card_rank == 13);
-
-   std::array<Card, num_cards> cards;
-
-   // Suits are carefully chosen to avoid flushes and his nob.
-   for (Rank i0 = 1; i0 <= 13; ++i0) {
-      cards[0] = { i0, 1 };
-      for (Rank i1 = i0; i1 <= 13; ++i1) {
-         cards[1] = { i1, 1 };
-         for (Rank i2 = i1; i2 <= 13; ++i2) {
-            cards[2] = { i2, 2 };
-            for (Rank i3 = i2; i3 <= 13; ++i3) {
-               cards[3] = { i3, 2 };
-               // Don't allow five-of-a-kind.
-               for (Rank i4 = std::max<Rank>(i3, i0 + 1); i4 <= 13; ++i4) {
-                  cards[4] = { i4, 3 };
-                  insert(cards);
-               }
-            }
+   auto points = (num_points_for_15 * ways[15]) + pair_points;
+
+   // Same algorithm as score_runs_and_pairs_in_hand. The extra slot at the
+   // end guarantees every run is zero-terminated.
+   auto run_length = 0;
+   auto run_multiplier = 1;
+   for (auto c : counts) {
+      if (c > 0) {
+         ++run_length;
+         run_multiplier *= c;
+      } else {
+         if (run_length >= 3) {
+            points += run_length * run_multiplier;
          }
+         run_length = 0;
+         run_multiplier = 1;
       }
    }
+   return points;
 }
 
-inline void SuitlessScores::insert(const std::array<Card, num_cards>& cards)
+// Adds every hand that extends the partial hand with ranks no larger than
+// max_rank. Ranks are added in descending order and each level loops in
+// ascending order, so hands are visited in colexicographic order, i.e., the
+// UnorderedRanksIndex of each hand is simply its position in the traversal.
+constexpr void add_suitless_hands(SuitlessScores::ScoreTable& scores,
+                                  int& index,
+                                  const SuitlessHand& hand,
+                                  Rank max_rank) noexcept
 {
-   // Crib only matters for flushes, so we can default crib to false.
-   auto points = score_hand(cards.begin(),
-                            std::prev(cards.end()),
-                            cards.back(),
-                            false);
-
-   UnorderedRanksKey key;
-   std::for_each(cards.begin(), cards.end(), [&key](auto& card) {
-      key.insert(card.rank());
-   });
-
-   scores_[key()] = points;
+   for (Rank rank = min_card_rank; rank <= max_rank; ++rank) {
+      auto next = hand.add(rank);
+      if (next.size == num_suitless_cards) {
+         // Five-of-a-kind has an index, but can never occur.
+         scores[index++] = static_cast<uint8_t>(next.score());
+      } else {
+         add_suitless_hands(scores, index, next, rank);
+      }
+   }
 }
 
+constexpr auto suitless_scores = [](){
+   SuitlessScores::ScoreTable scores{};
+   auto index = 0;
+   add_suitless_hands(scores, index, SuitlessHand(), max_card_rank);
+   return scores;
+}();
+
+const SuitlessScores::ScoreTable& SuitlessScores::get() noexcept
+{
+   return suitless_scores;
+}
+
+// Number of distinct multisets of num_cards_in_hand ranks, i.e., C(16, 4).
+constexpr int num_hand_multisets = 1820;
+
+// Suitless scores for every hand against each possible starter rank, indexed
+// by the UnorderedRanksIndex of the hand. This keeps the scores for a hand
+// together, so scoring against every starter doesn't have to look up each
+// five-card multiset.
+using StarterScores = std::array<uint8_t, num_card_ranks>;
+using StarterScoreTable = std::array<StarterScores, num_hand_multisets>;
+
+// Binomial coefficients, C(n, k), for computing indices at compile time.
+constexpr auto binomials = [](){
+   constexpr int max_n = num_card_ranks + num_suitless_cards;
+   std::array<std::array<int, num_suitless_cards + 1>, max_n> result{};
+   for (auto n = 0; n < max_n; ++n) {
+      result[n][0] = 1;
+      for (auto k = 1; k <= num_suitless_cards; ++k) {
+         result[n][k] = (n == 0) ? 0 : result[n - 1][k - 1] + result[n - 1][k];
+      }
+   }
+   return result;
+}();
+
+// Rank ordinals of a hand in ascending order.
+using SortedOrdinals = std::array<int, num_cards_in_hand>;
+
+// Returns the UnorderedRanksIndex of the hand plus the starter. As in
+// UnorderedRanksIndex, the ordinal at position i of the sorted multiset
+// contributes C(ordinal + i, i + 1) to the index.
+constexpr int index_with(const SortedOrdinals& hand, int starter) noexcept
+{
+   auto result = 0;
+   auto pos = 0;
+   auto inserted = false;
+   for (auto ordinal : hand) {
+      if (!inserted && (starter < ordinal)) {
+         result += binomials[starter + pos][pos + 1];
+         ++pos;
+         inserted = true;
+      }
+      result += binomials[ordinal + pos][pos + 1];
+      ++pos;
+   }
+   if (!inserted) {
+      result += binomials[starter + pos][pos + 1];
+   }
+   return result;
+}
+
+// Same traversal as add_suitless_hands, but stops one card short and looks up
+// the score of the hand with each possible starter. Ranks are added in
+// descending order, so the hand is filled from the back to keep it sorted.
+constexpr void add_starter_scores(StarterScoreTable& table,
+                                  int& index,
+                                  SortedOrdinals& hand,
+                                  int size,
+                                  int max_ordinal) noexcept
+{
+   for (auto ordinal = 0; ordinal <= max_ordinal; ++ordinal) {
+      hand[num_cards_in_hand - 1 - size] = ordinal;
+      if ((size + 1) == num_cards_in_hand) {
+         auto& scores = table[index++];
+         for (auto starter = 0; starter < num_card_ranks; ++starter) {
+            scores[starter] = suitless_scores[index_with(hand, starter)];
+         }
+      } else {
+         add_starter_scores(table, index, hand, size + 1, ordinal);
+      }
+   }
+}
+
+constexpr auto suitless_scores_by_starter = [](){
+   StarterScoreTable table{};
+   SortedOrdinals hand{};
+   auto index = 0;
+   add_starter_scores(table, index, hand, 0, num_card_ranks - 1);
+   return table;
+}();
+
 HandScore::HandScore(const Card* begin, const Card* end, bool crib) noexcept
 : crib_(crib)
 {
@@ -76,7 +185,7 @@ void HandScore::update(Card c) noexcept
       jacks_.set(c.suit());
    }
 
-   if (key_.empty()) {
+   if (index_.empty()) {
       // First card we've seen, so this is our candidate for flush suit.
       flush_suit_ = c.suit();
    } else if (flush_suit_ != c.suit()) {
@@ -84,7 +193,7 @@ void HandScore::update(Card c) noexcept
       flush_suit_ = -1;
    }
 
-   key_.insert(c.rank());
+   index_.insert(c.rank());
 }
 
 void HandScore::update(const Card* begin, const Card* end) noexcept
@@ -94,15 +203,8 @@ void HandScore::update(const Card* begin, const Card* end) noexcept
 
 int HandScore::score(Card starter) const noexcept
 {
-   // Create a copy, so we can modify it. This allows score to be called
-   // multiple times with different starters.
-   UnorderedRanksKey key(key_);
-   key.insert(starter.rank());
-
-   auto i = scores_.find(key());
-   // Map contains every possible hand, so lookup can never fail.
-   assert(i != scores_.end());
-   auto points = i->second;
+   assert(index_.size() == num_cards_in_hand);
+   int points = suitless_scores[index_.with(starter.rank())];
 
    // Now fix up the scoring that depends on suit.
 
@@ -120,3 +222,31 @@ int HandScore::score(Card starter) const noexcept
 
    return points;
 }
+
+int HandScore::score_all(const StarterSet& starters) const noexcept
+{
+   assert(index_.size() == num_cards_in_hand);
+   // The suitless score only depends on the starter's rank ...
+   const auto& scores = suitless_scores_by_starter[index_()];
+   int points = 0;
+   for (Rank rank = min_card_rank; rank <= max_card_rank; ++rank) {
+      points += starters.count_rank(rank) * scores[rank_ordinal(rank)];
+   }
+
+   // ... and the fix ups only depend on its suit.
+   for (Suit suit = min_card_suit; suit <= max_card_suit; ++suit) {
+      if (jacks_.test(suit)) {
+         points += starters.count_suit(suit) * num_points_for_his_nob;
+      }
+   }
+
+   if (flush_suit_ != -1) {
+      auto matching = starters.count_suit(flush_suit_);
+      points += matching * (num_cards_in_hand + 1);
+      if (!crib_) {
+         points += (starters.size() - matching) * num_cards_in_hand;
+      }
+   }
+
+   return points;
+}
@@ -13,30 +13,40 @@
 #include <algorithm>
 #include <array>
 #include <bitset>
+#include <cassert>
 #include <cstdint>
-#include <unordered_map>
 
-// Creates a map of all possible hands to their corresponding point values
-// without regard to suit (i.e., no points for flushes or his nob).
+// Table of all possible hands to their corresponding point values without
+// regard to suit (i.e., no points for flushes or his nob). The table is
+// indexed by the UnorderedRanksIndex of the hand plus starter and is generated
+// at compile time.
 class SuitlessScores
 {
 public:
-   using ScoreMap = std::unordered_map<UnorderedRanksKey::KeyType, int>;
+   using ScoreTable = std::array<uint8_t, num_rank_multisets>;
 
-   // Creating the map is expensive, so everyone shares a read-only singleton.
-   static const ScoreMap& get() noexcept;
+   static const ScoreTable& get() noexcept;
+};
 
-private:
-   // An extra card for the starter.
-   static constexpr int num_cards = num_cards_in_hand + 1;
+// Counts the cards that could be the starter by rank and by suit, so a hand
+// can be scored against all of them at once.
+class StarterSet
+{
+public:
+   // Starts with every card in the deck.
+   StarterSet() noexcept;
 
-   // Constructor is private since this is a singleton.
-   SuitlessScores();
+   void erase(Card c) noexcept;
+   void erase(const Card* begin, const Card* end) noexcept;
 
-   // Add the given hand to the ScoreMap.
-   void insert(const std::array<Card, num_cards>& cards);
+   int size() const noexcept;
+   int count_rank(Rank rank) const noexcept;
+   int count_suit(Suit suit) const noexcept;
 
-   ScoreMap scores_;
+private:
+   std::array<uint8_t, max_card_rank + 1> ranks_{};
+   std::array<uint8_t, max_card_suit + 1> suits_{};
+   int size_ = num_cards_in_deck;
 };
 
 // Scores a hand using a cached lookup, rather than starting from scratch.
@@ -52,10 +62,11 @@ public:
 
    // Returns the number of points.
    int score(Card starter) const noexcept;
+   // Returns the total points scored over every starter in the set.
+   int score_all(const StarterSet& starters) const noexcept;
 
 private:
-   UnorderedRanksKey key_;
-   const SuitlessScores::ScoreMap& scores_ = SuitlessScores::get();
+   UnorderedRanksIndex index_;
    bool crib_;
    // Tracks which jacks are in the hand.
    std::bitset<num_card_suits + 1> jacks_;
@@ -63,6 +74,41 @@ private:
    int flush_suit_ = -1;
 };
 
+inline StarterSet::StarterSet() noexcept
+{
+   std::fill(ranks_.begin() + min_card_rank, ranks_.end(), num_card_suits);
+   std::fill(suits_.begin() + min_card_suit, suits_.end(), num_card_ranks);
+}
+
+inline void StarterSet::erase(Card c) noexcept
+{
+   assert(ranks_[c.rank()] > 0);
+   assert(suits_[c.suit()] > 0);
+   --ranks_[c.rank()];
+   --suits_[c.suit()];
+   --size_;
+}
+
+inline void StarterSet::erase(const Card* begin, const Card* end) noexcept
+{
+   std::for_each(begin, end, [this](auto c){ erase(c); });
+}
+
+inline int StarterSet::size() const noexcept
+{
+   return size_;
+}
+
+inline int StarterSet::count_rank(Rank rank) const noexcept
+{
+   return ranks_[rank];
+}
+
+inline int StarterSet::count_suit(Suit suit) const noexcept
+{
+   return suits_[suit];
+}
+
 inline HandScore::HandScore(bool crib) noexcept
 : crib_(crib)
 { }
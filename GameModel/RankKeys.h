@@ -9,6 +9,8 @@
 #define RankKeys_h
 
 #include "Card.h"
+#include <array>
+#include <cstdint>
 
 // Generates an integer key that uniquely identifies an ordered set of ranks.
 class OrderedRanksKey
@@ -17,11 +19,17 @@ public:
    using KeyType = uint32_t;
 
    KeyType operator()() const noexcept;
+   // Returns the rank pushed i calls ago, i.e., [0] is the most recent, or
+   // zero if fewer ranks have been pushed.
+   Rank operator[](int i) const noexcept;
    bool empty() const noexcept;
    void clear() noexcept;
    void push_back(Rank rank) noexcept;
    void pop_back() noexcept;
 
+   // Maximum number of ranks in a key.
+   static constexpr int max_ranks = max_cards_in_play;
+
 private:
    KeyType key_ = 0;
 
@@ -33,11 +41,66 @@ private:
    static_assert((bit_width * max_cards_in_play) <= (sizeof(KeyType) * 8));
 };
 
+// Generates a dense index that uniquely identifies an unordered set of up to
+// five ranks. Sorting the ranks maps the multiset to a strictly increasing
+// combination of ordinals in [0, num_card_ranks + 4), which is then ranked in
+// colexicographic order. Five-card multisets map to [0, num_rank_multisets),
+// so the index can address a small flat array.
+//
+// Like UnorderedRanksKey, inserting a rank is a single add. The index is
+// computed on demand from the count of each rank, so there's no sorting.
+class UnorderedRanksIndex
+{
+public:
+   using IndexType = uint16_t;
+
+   static constexpr int max_ranks = num_cards_in_hand + 1;
+
+   IndexType operator()() const noexcept;
+   // Returns the index the multiset would have after inserting the rank
+   // without modifying it. This is the hot path when scoring every possible
+   // starter against the same hand.
+   IndexType with(Rank rank) const noexcept;
+   bool empty() const noexcept;
+   int size() const noexcept;
+   void clear() noexcept;
+   void insert(Rank rank) noexcept;
+
+private:
+   // Counts are packed into a word with bit_width bits per rank. This leaves
+   // room for a running total, so a single multiply computes how many ranks
+   // precede each rank.
+   static constexpr int bit_width = 3;
+   static_assert(max_ranks < (1 << bit_width));
+   static_assert((bit_width * (num_card_ranks + 1)) <= 64);
+
+   // Ranks are processed in pairs, so each pair's contribution to the index
+   // is a single table lookup.
+   static constexpr int num_groups = (num_card_ranks + 1) / 2;
+   static constexpr int group_width = 2 * bit_width;
+
+   static uint64_t count_bit(Rank rank) noexcept;
+   static IndexType rank(uint64_t counts) noexcept;
+
+   uint64_t counts_ = 0;
+   uint8_t size_ = 0;
+};
+
+// Number of distinct multisets of max_ranks ranks, i.e., C(17, 5).
+constexpr int num_rank_multisets = 6188;
+
 inline OrderedRanksKey::KeyType OrderedRanksKey::operator()() const noexcept
 {
    return key_;
 }
 
+inline Rank OrderedRanksKey::operator[](int i) const noexcept
+{
+   assert(i >= 0);
+   assert(i < max_ranks);
+   return static_cast<Rank>((key_ >> (bit_width * i)) & ((1u << bit_width) - 1));
+}
+
 inline bool OrderedRanksKey::empty() const noexcept
 {
    return key_ == 0;
@@ -115,4 +178,107 @@ UnorderedRanksKey::KeyType UnorderedRanksKey::multiplier(Rank rank) noexcept
    return multipliers[rank_ordinal(rank)];
 }
 
+inline UnorderedRanksIndex::IndexType UnorderedRanksIndex::operator()()
+const noexcept
+{
+   return rank(counts_);
+}
+
+inline UnorderedRanksIndex::IndexType UnorderedRanksIndex::with(Rank rank)
+const noexcept
+{
+   assert(size_ < max_ranks);
+   return UnorderedRanksIndex::rank(counts_ + count_bit(rank));
+}
+
+inline bool UnorderedRanksIndex::empty() const noexcept
+{
+   return size_ == 0;
+}
+
+inline int UnorderedRanksIndex::size() const noexcept
+{
+   return size_;
+}
+
+inline void UnorderedRanksIndex::clear() noexcept
+{
+   counts_ = 0;
+   size_ = 0;
+}
+
+inline void UnorderedRanksIndex::insert(Rank rank) noexcept
+{
+   assert(size_ < max_ranks);
+   counts_ += count_bit(rank);
+   ++size_;
+}
+
+inline uint64_t UnorderedRanksIndex::count_bit(Rank rank) noexcept
+{
+   return uint64_t{1} << (bit_width * rank_ordinal(rank));
+}
+
+inline UnorderedRanksIndex::IndexType UnorderedRanksIndex::rank(
+   uint64_t counts
+) noexcept
+{
+   // Each table entry is the contribution of a pair of ranks given the number
+   // of ranks that precede the pair and the count of each rank in the pair.
+   // In the sorted multiset, the ordinal at position i contributes
+   // C(ordinal + i, i + 1) to the index.
+   static constexpr int num_prefixes = 1 << bit_width;
+   static constexpr int num_entries = num_prefixes << group_width;
+   using Group = std::array<IndexType, num_entries>;
+   static constexpr auto groups = [](){
+      constexpr int num_values = num_card_ranks + max_ranks;
+      std::array<std::array<int, max_ranks + 1>, num_values> binomial{};
+      for (auto n = 0; n < num_values; ++n) {
+         binomial[n][0] = 1;
+         for (auto k = 1; k <= max_ranks; ++k) {
+            binomial[n][k] = (n == 0) ? 0 : binomial[n - 1][k - 1] +
+                                            binomial[n - 1][k];
+         }
+      }
+      std::array<Group, num_groups> result{};
+      for (auto g = 0; g < num_groups; ++g) {
+         for (auto entry = 0; entry < num_entries; ++entry) {
+            auto pos = entry >> group_width;
+            auto index = 0;
+            for (auto r = 2 * g; r < 2 * g + 2; ++r) {
+               auto count = (entry >> (bit_width * (r - 2 * g))) &
+                            (num_prefixes - 1);
+               for (; (count > 0) && (pos < max_ranks); --count, ++pos) {
+                  index += (r < num_card_ranks) ? binomial[r + pos][pos + 1]
+                                                : 0;
+               }
+            }
+            result[g][entry] = static_cast<IndexType>(index);
+         }
+      }
+      return result;
+   }();
+
+   // Multiplying by a 1 in every field computes running totals.
+   static constexpr auto ones = [](){
+      uint64_t result = 0;
+      for (auto i = 0; i <= num_card_ranks; ++i) {
+         result |= uint64_t{1} << (bit_width * i);
+      }
+      return result;
+   }();
+   auto totals = counts * ones;
+
+   // Sum in an int; 16-bit arithmetic causes partial register stalls.
+   constexpr uint64_t group_mask = (1u << group_width) - 1;
+   constexpr uint64_t prefix_mask = num_prefixes - 1;
+   int index = groups[0][counts & group_mask];
+   for (auto g = 1; g < num_groups; ++g) {
+      auto prefix = (totals >> ((g * group_width) - bit_width)) & prefix_mask;
+      auto pair = (counts >> (g * group_width)) & group_mask;
+      index += groups[g][(prefix << group_width) | pair];
+   }
+   return static_cast<IndexType>(index);
+}
+
 #endif /* RankKeys_h */
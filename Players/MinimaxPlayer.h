@@ -16,7 +16,19 @@
 class MinimaxPlayer : public Player
 {
 public:
-   explicit MinimaxPlayer(Discarder& discarder);
+   // If parallel is true, each card play decision uses all available threads.
+   // This is intended for interactive games; don't use it with Match, which
+   // already plays games in parallel. The budget limits the work done for
+   // each card play decision.
+   explicit MinimaxPlayer(
+      Discarder& discarder,
+      bool parallel = false,
+      const MinimaxStrategy::Budget& budget = MinimaxStrategy::Budget());
+   // The book and cache must outlive the player and any clones. Clones share
+   // them.
+   void set_opening_book(const OpeningBook* book) noexcept;
+   void set_solve_cache(SolveCache* cache) noexcept;
+
    virtual std::unique_ptr<Player> clone() const override;
    virtual CardsDiscarded get_discards(const GameView& game,
                                        const CardsInHand& hand) override;
@@ -36,8 +48,21 @@ private:
    MinimaxStrategy card_play_;
 };
 
-inline MinimaxPlayer::MinimaxPlayer(Discarder& discarder)
-: discarder_(discarder)
+inline MinimaxPlayer::MinimaxPlayer(Discarder& discarder,
+                                    bool parallel,
+                                    const MinimaxStrategy::Budget& budget)
+: discarder_(discarder),
+  card_play_(parallel, budget)
 { }
 
+inline void MinimaxPlayer::set_opening_book(const OpeningBook* book) noexcept
+{
+   card_play_.set_opening_book(book);
+}
+
+inline void MinimaxPlayer::set_solve_cache(SolveCache* cache) noexcept
+{
+   card_play_.set_solve_cache(cache);
+}
+
 #endif /* ExpectimaxPlayer_h */
@@ -0,0 +1,115 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#include "Catch.hpp"
+#include "BeliefMinimax.h"
+#include "CardPlayHands.h"
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+// Plain minimax for a single opponent hand.
+int minimax(const CardPlayNode& node) noexcept
+{
+   if (node.is_terminal()) {
+      return node.result();
+   }
+   auto maximize = node.is_current_player();
+   auto value = maximize ? INT_MIN : INT_MAX;
+   for (auto play : node.valid_plays()) {
+      auto child_value = minimax(node[play]);
+      value = maximize ? std::max(value, child_value)
+                       : std::min(value, child_value);
+   }
+   return value;
+}
+
+} // namespace
+
+TEST_CASE("BeliefMinimax")
+{
+   RanksInHand hand;
+   for (auto rank : { 5, 5, 10, 11 }) {
+      hand.push_back(rank);
+   }
+   RankCounts ranks_seen;
+   for (auto rank : hand) {
+      ranks_seen += rank;
+   }
+
+   // Play a few cards, so the trees are small enough for plain minimax.
+   CardPlayNode node;
+   node.start_new_round(hand, true);
+   node.make_play(4, true);
+   node.make_play(5);
+   node.make_play(6, true);
+   ranks_seen += 4;
+   ranks_seen += 6;
+   REQUIRE(node.is_current_player());
+
+   auto plays = node.valid_plays();
+   BeliefMinimax::Results expected(plays.size(), 0);
+   BeliefMinimax belief;
+   CardPlayHandsIterator hands(node.unseen_card_count(), ranks_seen);
+   while (hands.next()) {
+      belief.add_hand(hands.hand(), hands.combos());
+      auto game = node;
+      game.randomize(hands.hand());
+      for (auto j = 0; j < plays.size(); ++j) {
+         expected[j] += minimax(game[plays[j]]) * hands.combos();
+      }
+   }
+   REQUIRE(belief.num_hands() > 1);
+
+   // Solve twice, so the second pass reads values back from the table.
+   TranspositionTable table(12);
+   for (auto pass = 0; pass < 2; ++pass) {
+      auto results = belief.solve(table, node, plays);
+      CHECK(std::equal(results.begin(), results.end(), expected.begin()));
+   }
+}
+
+TEST_CASE("BeliefMinimax deadline")
+{
+   RanksInHand hand;
+   for (auto rank : { 1, 5, 9, 12 }) {
+      hand.push_back(rank);
+   }
+   RankCounts ranks_seen;
+   for (auto rank : hand) {
+      ranks_seen += rank;
+   }
+
+   // The whole round is far larger than the interval between clock checks.
+   CardPlayNode node;
+   node.start_new_round(hand, false);
+   auto plays = node.valid_plays();
+   BeliefMinimax belief;
+   CardPlayHandsIterator hands(node.unseen_card_count(), ranks_seen);
+   while (hands.next()) {
+      belief.add_hand(hands.hand(), hands.combos());
+   }
+
+   TranspositionTable table(16);
+   auto expected = belief.solve(table, node, plays);
+   REQUIRE(!belief.timed_out());
+
+   // A deadline that has already passed abandons the search. Nothing from
+   // the abandoned search may be cached.
+   TranspositionTable abandoned(16);
+   belief.set_deadline(BeliefMinimax::Clock::now());
+   belief.solve(abandoned, node, plays);
+   CHECK(belief.timed_out());
+
+   // A deadline that isn't reached doesn't change the results, even with the
+   // table left over from the abandoned search.
+   belief.set_deadline(BeliefMinimax::Clock::now() + std::chrono::hours(1));
+   auto results = belief.solve(abandoned, node, plays);
+   CHECK(!belief.timed_out());
+   CHECK(std::equal(results.begin(), results.end(), expected.begin()));
+}
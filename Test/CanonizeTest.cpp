@@ -0,0 +1,83 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#include "Catch.hpp"
+#include "Canonize.h"
+#include "Deck.h"
+#include <bitset>
+
+TEST_CASE("canonical_ordinal", "[discard]")
+{
+   // Every ordinal should round trip through a valid key.
+   auto num_passed = 0;
+   int64_t total_weight = 0;
+   for (auto i = 0; i < num_canonical_hands; ++i) {
+      auto key = canonical_key(i);
+      auto num_cards = std::bitset<64>(key).count();
+      // The cards for the key should already be in canonical order.
+      auto cards = canonical_cards(key);
+      auto copy = cards;
+      if ((num_cards == num_cards_dealt_per_player) &&
+          (canonical_ordinal(key) == i) &&
+          (canonize(copy) == key) &&
+          (copy == cards)) {
+         ++num_passed;
+      }
+      total_weight += canonical_weight(key);
+   }
+   REQUIRE(num_passed == num_canonical_hands);
+
+   // The weights should account for every possible deal.
+   REQUIRE(total_weight == num_hands_dealt);
+
+   // And every key produced by canonize should round trip through a valid
+   // ordinal.
+   const auto num_hands = 10000;
+   num_passed = 0;
+   Deck deck;
+   for (auto i = 0; i < num_hands; ++i) {
+      deck.shuffle();
+      auto cards = deal_cards(deck);
+      auto key = canonize(cards);
+      auto ordinal = canonical_ordinal(key);
+      if ((ordinal >= 0) &&
+          (ordinal < num_canonical_hands) &&
+          (canonical_key(ordinal) == key)) {
+         ++num_passed;
+      }
+   }
+   REQUIRE(num_passed == num_hands);
+}
+
+TEST_CASE("equivalent_actions", "[discard]")
+{
+   auto actions_for = [](const char* hand) {
+      std::vector<Card> cards;
+      REQUIRE(from_string(hand, cards));
+      CardsDealt dealt;
+      std::copy(cards.begin(), cards.end(), dealt.begin());
+      return equivalent_actions(canonize(dealt));
+   };
+
+   // No two suits hold the same ranks, so every action stands alone.
+   EquivalentActions distinct{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13,
+                               14 };
+   REQUIRE(actions_for("AS 2S 3S 4S 5S 6S") == distinct);
+   REQUIRE(actions_for("AS 2H 3C 4D 5S 6H") == distinct);
+
+   // Canonical order is A2 of two suits, then 3C, 4D. Swapping the suits
+   // pairs up the discards that take one card from each side.
+   EquivalentActions two_suits{ 0, 1, 2, 3, 4, 2, 6, 7, 8, 0, 3, 4, 7, 8,
+                                14 };
+   REQUIRE(actions_for("AS 2S AH 2H 3C 4D") == two_suits);
+
+   // With three interchangeable suits, the only choices are a suited A2, a
+   // pair of aces, a pair of deuces, or an unsuited A2.
+   EquivalentActions three_suits{ 0, 1, 2, 1, 2, 2, 6, 2, 6, 0, 1, 2, 2, 6,
+                                  0 };
+   REQUIRE(actions_for("AS 2S AH 2H AD 2D") == three_suits);
+}
@@ -39,4 +39,18 @@ TEST_CASE("CardPlayHands")
       auto expected = (48 * 47 * 46 * 45)/(4 * 3 * 2 * 1);
       test_total_combos(ranks_seen, expected);
    }
+   {
+      // Keys depend only on the counts, not the order the ranks were seen.
+      RankCounts lhs, rhs;
+      lhs += 4;
+      lhs += 9;
+      lhs += 4;
+      rhs += 9;
+      rhs += 4;
+      rhs += 4;
+      CHECK(lhs.key() == rhs.key());
+      rhs.add_all(13);
+      CHECK(lhs.key() != rhs.key());
+      CHECK(rhs.key() < (uint64_t{1} << RankCounts::key_bits));
+   }
 }
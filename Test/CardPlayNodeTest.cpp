@@ -0,0 +1,62 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#include "Catch.hpp"
+#include "CardPlayNode.h"
+
+namespace {
+
+bool same_key(const CardPlayNode& lhs, const CardPlayNode& rhs) noexcept
+{
+   auto lkey = lhs.key();
+   auto rkey = rhs.key();
+   return (lkey.observer == rkey.observer) && (lkey.opponent == rkey.opponent);
+}
+
+// Walks the whole tree, verifying that do_play matches operator[] and that
+// undo_play restores the node.
+void test_undo(CardPlayNode& node, int& num_nodes) noexcept
+{
+   ++num_nodes;
+   if (node.is_terminal()) {
+      return;
+   }
+   for (auto play : node.valid_plays()) {
+      const auto before = node;
+      const auto child = node[play];
+      auto points = node.points(play);
+      auto undo = node.do_play(play);
+      CHECK(same_key(node, child));
+      CHECK(node.result() == child.result());
+      CHECK(node.result() - before.result() == points);
+      test_undo(node, num_nodes);
+      node.undo_play(undo);
+      CHECK(same_key(node, before));
+      CHECK(node.result() == before.result());
+   }
+}
+
+} // namespace
+
+TEST_CASE("CardPlayNode::undo_play")
+{
+   RanksInHand observer;
+   RanksInHand opponent;
+   for (auto rank : { 5, 5, 10, 11 }) {
+      observer.push_back(rank);
+   }
+   for (auto rank : { 4, 5, 6, 13 }) {
+      opponent.push_back(rank);
+   }
+
+   CardPlayNode node;
+   node.start_new_round(observer, true);
+   node.randomize(opponent);
+   auto num_nodes = 0;
+   test_undo(node, num_nodes);
+   CHECK(num_nodes > 1);
+}
@@ -7,6 +7,11 @@
 
 #include "Catch.hpp"
 #include "CardPlayScore.h"
+#include "Deck.h"
+#include "Score.h"
+#include <algorithm>
+#include <array>
+#include <vector>
 
 TEST_CASE("CardPlayScore::play_rank", "[score]")
 {
@@ -33,3 +38,187 @@ TEST_CASE("CardPlayScore::play_rank", "[score]")
    }
    REQUIRE(points == expected_points);
 }
+
+TEST_CASE("CardPlayScore", "[score]")
+{
+   // Verify randomly generated series are scored the same using either
+   // manual scoring or incremental scoring.
+   const auto num_series = 1000;
+   auto num_passed = 0;
+   auto num_scored = 0;
+
+   Deck deck;
+   for (auto j = 0; j < num_series; ++j) {
+      deck.shuffle();
+      CardsInPlay cards;
+      CardPlayScore score;
+      auto count = 0;
+      while (cards.size() < cards.capacity()) {
+         auto c = deck.deal_card();
+         if ((count + c.value()) > max_count_in_play) {
+            break;
+         }
+         cards.push_back(c);
+         count += c.value();
+         auto points = score.update_and_score(c.rank());
+         auto expected = score_cards_in_play(cards.begin(), cards.end());
+         ++num_scored;
+         if (points == expected) {
+            ++num_passed;
+         }
+      }
+   }
+
+   REQUIRE(num_scored == num_passed);
+}
+
+namespace {
+
+// Extends the series with every legal play, recursively, and checks that the
+// incremental score matches the manual score after each play.
+void check_every_series(CardsInPlay& cards,
+                        const CardPlayScore& score,
+                        int count,
+                        std::array<int, num_card_ranks>& num_played,
+                        int& num_scored,
+                        int& num_passed)
+{
+   if (cards.size() == cards.capacity()) {
+      return;
+   }
+   for (Rank rank = min_card_rank; rank <= max_card_rank; ++rank) {
+      auto& played = num_played[rank_ordinal(rank)];
+      if ((played == num_card_suits) ||
+          ((count + rank_value(rank)) > max_count_in_play)) {
+         continue;
+      }
+      // Suits don't matter during card play, but the cards must be distinct.
+      cards.push_back(Card(rank, static_cast<Suit>(min_card_suit + played)));
+      ++played;
+      auto next = score;
+      auto points = next.update_and_score(rank);
+      auto expected = score_cards_in_play(cards.begin(), cards.end());
+      ++num_scored;
+      if (points == expected) {
+         ++num_passed;
+      }
+      check_every_series(cards,
+                         next,
+                         count + rank_value(rank),
+                         num_played,
+                         num_scored,
+                         num_passed);
+      --played;
+      cards.pop_back();
+   }
+}
+
+} // namespace
+
+TEST_CASE("CardPlayScore every series", "[score]")
+{
+   // Verify every legal series is scored the same using either manual scoring
+   // or incremental scoring.
+   CardsInPlay cards;
+   std::array<int, num_card_ranks> num_played{};
+   auto num_scored = 0;
+   auto num_passed = 0;
+   check_every_series(cards,
+                      CardPlayScore(),
+                      0,
+                      num_played,
+                      num_scored,
+                      num_passed);
+
+   REQUIRE(num_scored == 12'892'167);
+   REQUIRE(num_scored == num_passed);
+}
+
+namespace {
+
+// Same as check_every_series, but drives the automaton directly and records
+// which states are visited.
+void check_every_transition(CardsInPlay& cards,
+                            CardPlayAutomaton::State state,
+                            int count,
+                            std::array<int, num_card_ranks>& num_played,
+                            std::vector<bool>& visited,
+                            int& num_scored,
+                            int& num_passed)
+{
+   visited[state] = true;
+   if (cards.size() == cards.capacity()) {
+      return;
+   }
+   for (Rank rank = min_card_rank; rank <= max_card_rank; ++rank) {
+      auto& played = num_played[rank_ordinal(rank)];
+      if ((played == num_card_suits) ||
+          ((count + rank_value(rank)) > max_count_in_play)) {
+         continue;
+      }
+      cards.push_back(Card(rank, static_cast<Suit>(min_card_suit + played)));
+      ++played;
+      auto transition = CardPlayAutomaton::next(state, rank);
+      auto expected = score_cards_in_play(cards.begin(), cards.end());
+      ++num_scored;
+      if (transition.points == expected) {
+         ++num_passed;
+      }
+      check_every_transition(cards,
+                             transition.next,
+                             count + rank_value(rank),
+                             num_played,
+                             visited,
+                             num_scored,
+                             num_passed);
+      --played;
+      cards.pop_back();
+   }
+}
+
+} // namespace
+
+TEST_CASE("CardPlayAutomaton", "[score]")
+{
+   // The compiled-in table must match a freshly built one.
+   auto table = CardPlayAutomaton::build();
+   REQUIRE(table.size() == CardPlayAutomaton::num_states);
+   auto num_mismatched = 0;
+   for (auto state = 0; state < table.size(); ++state) {
+      for (Rank rank = min_card_rank; rank <= max_card_rank; ++rank) {
+         const auto& built = table[state][rank_ordinal(rank)];
+         if (built.points == CardPlayAutomaton::illegal) {
+            continue;
+         }
+         auto compiled = CardPlayAutomaton::next(
+            static_cast<CardPlayAutomaton::State>(state),
+            rank
+         );
+         if ((compiled.next != built.next) ||
+             (compiled.points != built.points)) {
+            ++num_mismatched;
+         }
+      }
+   }
+   REQUIRE(num_mismatched == 0);
+
+   // Every legal series must score correctly, and every state must be
+   // reachable.
+   CardsInPlay cards;
+   std::array<int, num_card_ranks> num_played{};
+   std::vector<bool> visited(CardPlayAutomaton::num_states);
+   auto num_scored = 0;
+   auto num_passed = 0;
+   check_every_transition(cards,
+                          CardPlayAutomaton::start,
+                          0,
+                          num_played,
+                          visited,
+                          num_scored,
+                          num_passed);
+
+   REQUIRE(num_scored == 12'892'167);
+   REQUIRE(num_scored == num_passed);
+   REQUIRE(std::count(visited.begin(), visited.end(), true) ==
+           CardPlayAutomaton::num_states);
+}
@@ -0,0 +1,248 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#include "Catch.hpp"
+#include "DiscardSimulator.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Mode = DiscardSimulator::Mode;
+
+constexpr char hvh_file[] = "test_sim_hvh.dat";
+constexpr char results_file[] = "test_sim_results.dat";
+constexpr uint64_t seed = 12345;
+
+// Loads a table where nobody scores any points during the play, so only the
+// hands and the crib count.
+void load_hvh(HandVsHand& hvh)
+{
+   {
+      std::vector<HandVsHand::Cell> cells(
+         HandVsHand::num_hands * HandVsHand::num_hands,
+         HandVsHand::Cell{ 0, 0 }
+      );
+      std::ofstream ostrm(hvh_file, std::ios::binary | std::ios::trunc);
+      ostrm.write(reinterpret_cast<const char*>(cells.data()),
+                  cells.size() * sizeof(HandVsHand::Cell));
+   }
+   auto loaded = hvh.load(hvh_file);
+   std::remove(hvh_file);
+   REQUIRE(loaded);
+}
+
+// Opponent that plays action 0 for every hand.
+DiscardTable make_opponent()
+{
+   DiscardTable table;
+   for (auto i = 0; i < num_canonical_hands; ++i) {
+      table.insert(canonical_key(i), 0, 0);
+   }
+   return table;
+}
+
+// Mean points for every state that was dealt, in ordinal order.
+struct StateMeans {
+   int ordinal;
+   bool dealer;
+   DiscardSimulator::ActionPoints points;
+};
+
+std::vector<StateMeans> state_means(const DiscardSimulator& sim)
+{
+   std::vector<StateMeans> result;
+   for (auto i = 0; i < num_canonical_hands; ++i) {
+      for (auto dealer : { false, true }) {
+         StateMeans state{ i, dealer, {} };
+         if (sim.mean_points(i, dealer, state.points)) {
+            result.push_back(state);
+         }
+      }
+   }
+   return result;
+}
+
+std::vector<StateMeans> simulate(const DiscardTable& opponent,
+                                 const HandVsHand& hvh,
+                                 Mode mode,
+                                 int64_t num_hands)
+{
+   DiscardSimulator sim(opponent, hvh, mode);
+   sim.set_seed(seed);
+   sim.simulate(num_hands);
+   return state_means(sim);
+}
+
+// Mean and standard error of one action's points across the states. Both
+// roles share the observer's hand from the same deal, so only the deals count
+// towards the standard error.
+std::pair<double, double> pooled_mean(const std::vector<StateMeans>& states,
+                                      int action)
+{
+   double sum = 0.0, sum_squares = 0.0;
+   for (const auto& state : states) {
+      sum += state.points[action];
+      sum_squares += state.points[action] * state.points[action];
+   }
+   const double count = states.size();
+   auto mean = sum / count;
+   auto std_dev = std::sqrt((sum_squares / count) - (mean * mean));
+   return { mean, std_dev / std::sqrt(count / 2.0) };
+}
+
+} // namespace
+
+TEST_CASE("DiscardSimulator control variate", "[discard]")
+{
+   HandVsHand hvh;
+   load_hvh(hvh);
+   const auto opponent = make_opponent();
+   const int64_t num_hands = 20000;
+
+   // With the same seed, both modes see exactly the same deals.
+   auto all_starters = simulate(opponent, hvh, Mode::all_starters, num_hands);
+   auto control = simulate(opponent, hvh, Mode::control_variate, num_hands);
+   REQUIRE(all_starters.size() == control.size());
+   REQUIRE(all_starters.size() > num_hands);
+
+   // The only difference is how the observer's hand is scored, and the
+   // control variate is its exact expected value, so the differences should
+   // average out to zero for every action.
+   std::array<double, num_discard_actions> sums{}, sum_squares{};
+   auto num_mismatches = 0;
+   for (auto i = 0; i < all_starters.size(); ++i) {
+      const auto& lhs = all_starters[i];
+      const auto& rhs = control[i];
+      num_mismatches += (lhs.ordinal != rhs.ordinal) ||
+                        (lhs.dealer != rhs.dealer);
+      for (auto a = 0; a < num_discard_actions; ++a) {
+         auto diff = rhs.points[a] - lhs.points[a];
+         sums[a] += diff;
+         sum_squares[a] += diff * diff;
+      }
+   }
+   REQUIRE(num_mismatches == 0);
+
+   // Both roles share the observer's hand from the same deal, so only count
+   // the deals when computing the standard error.
+   const double count = all_starters.size();
+   for (auto a = 0; a < num_discard_actions; ++a) {
+      auto mean = sums[a] / count;
+      auto std_dev = std::sqrt((sum_squares[a] / count) - (mean * mean));
+      auto std_error = std_dev / std::sqrt(count / 2.0);
+      CAPTURE(a, mean, std_error);
+      CHECK(std_dev > 0.0);
+      CHECK(std::abs(mean) < 4.0 * std_error);
+   }
+}
+
+TEST_CASE("DiscardSimulator importance sampling", "[discard]")
+{
+   HandVsHand hvh;
+   load_hvh(hvh);
+   const auto opponent = make_opponent();
+   const int64_t num_hands = 20000;
+   DiscardSimulator::StoppingRule rule;
+   rule.min_count = 2;
+   DiscardTable response;
+
+   // Results from an earlier simulation. Loading them twice gives every hand
+   // two identical samples, so every hand dealt has been decided.
+   std::vector<StateMeans> earlier;
+   {
+      DiscardSimulator sim(opponent, hvh, Mode::all_starters);
+      sim.set_seed(seed);
+      sim.simulate(num_hands);
+      sim.save(results_file);
+      earlier = state_means(sim);
+   }
+   std::vector<bool> decided(2 * num_canonical_hands, false);
+   for (const auto& state : earlier) {
+      decided[(2 * state.ordinal) + state.dealer] = true;
+   }
+
+   // Uniform sampling for comparison.
+   std::vector<StateMeans> uniform;
+   double uniform_exploitability;
+   {
+      DiscardSimulator sim(opponent, hvh, Mode::all_starters);
+      sim.set_seed(seed + 1);
+      sim.simulate(num_hands);
+      uniform = state_means(sim);
+      uniform_exploitability = sim.best_response(response);
+   }
+
+   DiscardSimulator sim(opponent, hvh, Mode::all_starters);
+   REQUIRE(sim.load(results_file));
+   REQUIRE(sim.merge(results_file));
+   std::remove(results_file);
+   sim.set_importance_sampling(true);
+   sim.set_seed(seed + 2);
+   REQUIRE(sim.simulate(num_hands, rule) == num_hands);
+   auto weighted = state_means(sim);
+   auto weighted_exploitability = sim.best_response(response);
+
+   // Decided hands are dealt far less often than under uniform sampling. A
+   // decided hand that's dealt again no longer has its earlier mean.
+   auto num_uniform_decided = 0;
+   for (const auto& state : uniform) {
+      num_uniform_decided += decided[(2 * state.ordinal) + state.dealer];
+   }
+   auto num_weighted_decided = 0;
+   auto i = 0;
+   for (const auto& state : earlier) {
+      while ((weighted[i].ordinal != state.ordinal) ||
+             (weighted[i].dealer != state.dealer)) {
+         ++i;
+      }
+      num_weighted_decided += (weighted[i].points != state.points);
+   }
+   CAPTURE(num_uniform_decided, num_weighted_decided);
+   REQUIRE(num_uniform_decided > 100);
+   CHECK(4 * num_weighted_decided < num_uniform_decided);
+
+   // Every other hand is dealt in proportion to its frequency, so the means
+   // across those hands agree with uniform sampling.
+   auto undecided = [&decided](const auto& states) {
+      std::vector<StateMeans> result;
+      for (const auto& state : states) {
+         if (!decided[(2 * state.ordinal) + state.dealer]) {
+            result.push_back(state);
+         }
+      }
+      return result;
+   };
+   auto uniform_undecided = undecided(uniform);
+   auto weighted_undecided = undecided(weighted);
+   for (auto a = 0; a < num_discard_actions; ++a) {
+      auto [uniform_mean, uniform_error] = pooled_mean(uniform_undecided, a);
+      auto [weighted_mean, weighted_error] = pooled_mean(weighted_undecided, a);
+      auto std_error = std::hypot(uniform_error, weighted_error);
+      CAPTURE(a, uniform_mean, weighted_mean, std_error);
+      CHECK(std::abs(weighted_mean - uniform_mean) < 4.0 * std_error);
+   }
+
+   // Exploitability weights each hand by how often it's dealt, not how often
+   // it was simulated, so importance sampling doesn't bias it. Decided hands
+   // have been simulated more often than the rest. Both roles are averaged.
+   auto points_sum = 0.0, weight_sum = 0.0;
+   for (const auto& state : weighted) {
+      auto weight = canonical_weight(canonical_key(state.ordinal));
+      points_sum += weight * *std::max_element(state.points.begin(),
+                                               state.points.end());
+      weight_sum += weight;
+   }
+   CHECK(weighted_exploitability == Approx(points_sum / weight_sum));
+   CAPTURE(uniform_exploitability, weighted_exploitability);
+   CHECK(weighted_exploitability == Approx(uniform_exploitability).margin(0.1));
+}
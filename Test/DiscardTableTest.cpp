@@ -0,0 +1,77 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#include "Catch.hpp"
+#include "DiscardTable.h"
+#include "FileIO.h"
+#include <unordered_map>
+
+constexpr char table_file[] = "test_table.dat";
+
+TEST_CASE("DiscardTable save/load", "[discard]")
+{
+   DiscardTable in;
+   for (auto i = 0; i < num_canonical_hands; i += 1000) {
+      in.insert(canonical_key(i), i % num_discard_actions, (i / 7) % num_discard_actions);
+   }
+   in.save(table_file);
+
+   DiscardTable out;
+   REQUIRE(out.load(table_file));
+
+   auto num_passed = 0;
+   for (auto i = 0; i < num_canonical_hands; ++i) {
+      auto key = canonical_key(i);
+      if (i % 1000 != 0) {
+         num_passed += !out.contains(key);
+         continue;
+      }
+      auto actions = out.find(key);
+      if ((actions.dealer == i % num_discard_actions) &&
+          (actions.pone == (i / 7) % num_discard_actions)) {
+         ++num_passed;
+      }
+   }
+   REQUIRE(num_passed == num_canonical_hands);
+
+   // Modifying a copy of a loaded table shouldn't affect the original.
+   DiscardTable copy(out);
+   copy.insert(canonical_key(0), 1, 2);
+   REQUIRE(copy.find(canonical_key(0)).dealer == 1);
+   REQUIRE(out.find(canonical_key(0)).dealer == 0);
+}
+
+TEST_CASE("DiscardTable legacy format", "[discard]")
+{
+   // Legacy files are a map from key to dealer and pone actions.
+   std::unordered_map<uint64_t, DiscardTable::Actions> legacy = {
+      { canonical_key(0),    { 3, 4 } },
+      { canonical_key(5000), { 14, 0 } }
+   };
+   {
+      std::ofstream ostrm(table_file, std::ios::binary | std::ios::trunc);
+      write_pod_map(ostrm, legacy);
+   }
+
+   DiscardTable table;
+   REQUIRE(table.load(table_file));
+   REQUIRE(table.find(canonical_key(0)).dealer == 3);
+   REQUIRE(table.find(canonical_key(0)).pone == 4);
+   REQUIRE(table.find(canonical_key(5000)).dealer == 14);
+   REQUIRE(table.find(canonical_key(5000)).pone == 0);
+   REQUIRE(!table.contains(canonical_key(1)));
+
+   // Saving converts the table to the current format.
+   table.save(table_file);
+   DiscardTable converted;
+   REQUIRE(converted.load(table_file));
+   REQUIRE(converted.find(canonical_key(0)).dealer == 3);
+   REQUIRE(converted.find(canonical_key(0)).pone == 4);
+   REQUIRE(converted.find(canonical_key(5000)).dealer == 14);
+   REQUIRE(converted.find(canonical_key(5000)).pone == 0);
+   REQUIRE(!converted.contains(canonical_key(1)));
+}
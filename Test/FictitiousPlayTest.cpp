@@ -0,0 +1,96 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#include "Catch.hpp"
+#include "FictitiousPlay.h"
+#include <cstdio>
+
+namespace {
+
+constexpr char solver_file[] = "test_fp.dat";
+
+// Starting strategy that plays action 0 for every hand.
+DiscardTable make_initial()
+{
+   DiscardTable table;
+   for (auto i = 0; i < num_canonical_hands; ++i) {
+      table.insert(canonical_key(i), 0, 0);
+   }
+   return table;
+}
+
+// Results where only ordinal 0 was dealt and the given action scored the
+// given points as both dealer and pone. Every other action scored zero.
+FictitiousPlay::MeanPoints one_hand(int action, double value)
+{
+   return [action, value](int ordinal,
+                          bool dealer,
+                          FictitiousPlay::ActionPoints& points) {
+      if (ordinal != 0) {
+         return false;
+      }
+      points.fill(0.0);
+      points[action] = value;
+      return true;
+   };
+}
+
+// Returns the dealer action for the given ordinal.
+int dealer_action(const DiscardTable& table, int ordinal)
+{
+   return table.find(canonical_key(ordinal)).dealer;
+}
+
+} // namespace
+
+TEST_CASE("FictitiousPlay", "[discard]")
+{
+   FictitiousPlay solver(make_initial());
+   REQUIRE(solver.num_iterations() == 1);
+   REQUIRE(dealer_action(solver.current(), 0) == 0);
+
+   // Values vs. the average are the mean of the values vs. each strategy, and
+   // only hands with results count towards exploitability.
+   REQUIRE(solver.update(one_hand(3, 4.0), 100) == Approx(4.0));
+   REQUIRE(solver.num_iterations() == 2);
+   REQUIRE(solver.num_hands() == 100);
+   auto current = solver.current();
+   REQUIRE(dealer_action(current, 0) == 3);
+   REQUIRE(current.find(canonical_key(0)).pone == 3);
+   // Hands never dealt keep playing the same action.
+   REQUIRE(dealer_action(current, 1) == 0);
+   // Actions 0 and 3 have each been played once, so the tie goes to the
+   // latest.
+   REQUIRE(dealer_action(solver.average(), 0) == 3);
+
+   REQUIRE(solver.update(one_hand(3, 4.0), 100) == Approx(4.0));
+   REQUIRE(dealer_action(solver.average(), 0) == 3);
+
+   // Action 7 now has the highest mean value, but action 3 has been played
+   // more often.
+   REQUIRE(solver.update(one_hand(7, 20.0), 100) == Approx(20.0 / 3.0));
+   REQUIRE(dealer_action(solver.current(), 0) == 7);
+   REQUIRE(dealer_action(solver.average(), 0) == 3);
+
+   solver.save(solver_file);
+
+   // Actions 3 and 7 have each been played twice.
+   REQUIRE(solver.update(one_hand(7, 20.0), 100) == Approx(10.0));
+   REQUIRE(dealer_action(solver.average(), 0) == 7);
+
+   // Loading restores the state as of the save.
+   REQUIRE(solver.load(solver_file));
+   REQUIRE(solver.num_iterations() == 4);
+   REQUIRE(solver.num_hands() == 300);
+   REQUIRE(dealer_action(solver.current(), 0) == 7);
+   REQUIRE(dealer_action(solver.average(), 0) == 3);
+   REQUIRE(solver.update(one_hand(7, 20.0), 100) == Approx(10.0));
+   REQUIRE(dealer_action(solver.average(), 0) == 7);
+
+   std::remove(solver_file);
+   REQUIRE(!solver.load(solver_file));
+}
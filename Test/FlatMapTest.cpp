@@ -0,0 +1,85 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#include "Catch.hpp"
+#include "FileIO.h"
+#include "FlatMap.h"
+#include <map>
+#include <vector>
+
+TEST_CASE("FlatMap insert/find", "[util]")
+{
+   FlatMap<uint32_t, int> map;
+   REQUIRE(map.empty());
+   REQUIRE(map.find(0) == map.end());
+
+   // Enough entries to force several rehashes. Zero is a valid key.
+   const auto num_entries = 10000;
+   for (auto i = 0; i < num_entries; ++i) {
+      map[i * 16] = i;
+   }
+   REQUIRE(map.size() == num_entries);
+   REQUIRE(!map.insert({ 16, -1 }));
+   REQUIRE(map.insert({ 17, 17 }));
+   REQUIRE(map.size() == num_entries + 1);
+
+   auto num_found = 0;
+   for (auto i = 0; i < num_entries; ++i) {
+      auto iter = map.find(i * 16);
+      if ((iter != map.end()) && (iter->second == i)) {
+         ++num_found;
+      }
+   }
+   REQUIRE(num_found == num_entries);
+   REQUIRE(!map.contains(15));
+   REQUIRE(map.contains(17));
+
+   // Iteration should visit every entry exactly once.
+   std::map<uint32_t, int> visited(map.begin(), map.end());
+   REQUIRE(visited.size() == map.size());
+
+   map.freeze();
+   REQUIRE(map.frozen());
+   REQUIRE(map.find(32)->second == 2);
+}
+
+TEST_CASE("FlatMap bulk construction", "[util]")
+{
+   std::vector<std::pair<uint64_t, int>> sorted;
+   for (auto i = 0; i < 100; ++i) {
+      sorted.emplace_back(i * i, i);
+   }
+   FlatMap<uint64_t, int> map(sorted.begin(), sorted.end());
+   REQUIRE(map.size() == sorted.size());
+   REQUIRE(map.find(81)->second == 9);
+}
+
+TEST_CASE("FlatMap write/read_pod_map", "[util]")
+{
+   constexpr char map_file[] = "test_flat_map.dat";
+
+   FlatMap<uint32_t, int> in;
+   for (auto i = 0; i < 50; ++i) {
+      in[i] = i * i;
+   }
+   {
+      std::ofstream ostrm(map_file, std::ios::binary | std::ios::trunc);
+      write_pod_map(ostrm, in);
+   }
+
+   FlatMap<uint32_t, int> out;
+   {
+      std::ifstream istrm(map_file, std::ios::binary);
+      REQUIRE(istrm.is_open());
+      REQUIRE(read_pod_map(istrm, out));
+      REQUIRE(read_complete(istrm));
+   }
+
+   std::map<uint32_t, int> lhs(in.begin(), in.end());
+   std::map<uint32_t, int> rhs(out.begin(), out.end());
+   REQUIRE(lhs == rhs);
+}
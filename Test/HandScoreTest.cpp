@@ -39,3 +39,126 @@ TEST_CASE("HandScore", "[score]")
 
    REQUIRE(num_hands == num_passsed);
 }
+
+TEST_CASE("HandScore::score_all", "[score]")
+{
+   // Scoring against every starter at once should match scoring against each
+   // starter one at a time, for hands and cribs.
+   const auto num_hands = 200;
+   auto num_passsed = 0;
+
+   Deck deck;
+   CardsShown hand;
+
+   for (auto j = 0; j < num_hands; ++j) {
+      deck.shuffle();
+      std::generate(hand.begin(),
+                    hand.end(),
+                    [&deck](){ return deck.deal_card(); });
+      // Remove a few more cards from the possible starters.
+      std::array<Card, 8> unseen;
+      std::generate(unseen.begin(),
+                    unseen.end(),
+                    [&deck](){ return deck.deal_card(); });
+
+      StarterSet starters;
+      starters.erase(hand.begin(), hand.end());
+      starters.erase(unseen.begin(), unseen.end());
+
+      auto crib = (j % 2) == 1;
+      HandScore score(hand.begin(), hand.end(), crib);
+      auto expected = 0;
+      for (auto i = 0; i < num_cards_in_deck; ++i) {
+         Card starter(i);
+         if ((std::find(hand.begin(), hand.end(), starter) == hand.end()) &&
+             (std::find(unseen.begin(), unseen.end(), starter) ==
+              unseen.end())) {
+            expected += score.score(starter);
+         }
+      }
+
+      if (score.score_all(starters) == expected) {
+         ++num_passsed;
+      }
+   }
+
+   REQUIRE(num_hands == num_passsed);
+}
+
+TEST_CASE("HandScore::score_all every rank multiset", "[score]")
+{
+   // The suitless scores by starter are generated at compile time, so check
+   // every multiset of ranks a hand can hold against scoring one at a time.
+   auto num_hands = 0;
+   auto num_passed = 0;
+   std::array<Rank, num_cards_in_hand> ranks;
+   for (ranks[0] = 1; ranks[0] <= 13; ++ranks[0]) {
+      for (ranks[1] = ranks[0]; ranks[1] <= 13; ++ranks[1]) {
+         for (ranks[2] = ranks[1]; ranks[2] <= 13; ++ranks[2]) {
+            for (ranks[3] = ranks[2]; ranks[3] <= 13; ++ranks[3]) {
+               // Every card gets a different suit, so the cards are distinct.
+               CardsKept hand;
+               for (auto i = 0; i < num_cards_in_hand; ++i) {
+                  hand[i] = Card(ranks[i], static_cast<Suit>(i + 1));
+               }
+               StarterSet starters;
+               starters.erase(hand.begin(), hand.end());
+
+               HandScore score(hand.begin(), hand.end(), false);
+               auto expected = 0;
+               for (auto i = 0; i < num_cards_in_deck; ++i) {
+                  Card starter(i);
+                  if (std::find(hand.begin(), hand.end(), starter) ==
+                      hand.end()) {
+                     expected += score.score(starter);
+                  }
+               }
+
+               ++num_hands;
+               if (score.score_all(starters) == expected) {
+                  ++num_passed;
+               }
+            }
+         }
+      }
+   }
+
+   REQUIRE(num_hands == 1820);
+   REQUIRE(num_hands == num_passed);
+}
+
+TEST_CASE("UnorderedRanksIndex", "[score]")
+{
+   // Every multiset of five ranks should map to a distinct index in
+   // [0, num_rank_multisets) regardless of the order the ranks are inserted.
+   std::vector<bool> seen(num_rank_multisets);
+   auto num_passed = 0;
+   std::array<Rank, 5> ranks;
+   for (ranks[0] = 1; ranks[0] <= 13; ++ranks[0]) {
+      for (ranks[1] = ranks[0]; ranks[1] <= 13; ++ranks[1]) {
+         for (ranks[2] = ranks[1]; ranks[2] <= 13; ++ranks[2]) {
+            for (ranks[3] = ranks[2]; ranks[3] <= 13; ++ranks[3]) {
+               for (ranks[4] = ranks[3]; ranks[4] <= 13; ++ranks[4]) {
+                  UnorderedRanksIndex forward, reverse;
+                  for (auto i = 0; i < 4; ++i) {
+                     forward.insert(ranks[i]);
+                     reverse.insert(ranks[4 - i]);
+                  }
+                  auto index = forward.with(ranks[4]);
+                  forward.insert(ranks[4]);
+                  reverse.insert(ranks[0]);
+                  if ((index == forward()) &&
+                      (index == reverse()) &&
+                      (index < num_rank_multisets) &&
+                      !seen[index]) {
+                     seen[index] = true;
+                     ++num_passed;
+                  }
+               }
+            }
+         }
+      }
+   }
+
+   REQUIRE(num_passed == num_rank_multisets);
+}
@@ -0,0 +1,113 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#include "Catch.hpp"
+#include "CardPlayHands.h"
+#include "HandVsHand.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+TEST_CASE("HandVsHand")
+{
+   // The table is persisted in CardPlayHands order, so the ordinals must
+   // match it exactly.
+   auto hands = CardPlayHands::hands(num_cards_in_hand);
+   REQUIRE(hands.size() == HandVsHand::num_hands);
+   for (auto i = 0; i < hands.size(); ++i) {
+      CHECK(HandVsHand::ordinal(hands[i].hand) == i);
+   }
+
+   // Order of the cards doesn't matter.
+   CardsKept kept = { Card(11, 1), Card(5, 2), Card(11, 3), Card(1, 4) };
+   RanksInHand ranks;
+   ranks.push_back(1);
+   ranks.push_back(5);
+   ranks.push_back(11);
+   ranks.push_back(11);
+   CHECK(HandVsHand::ordinal(kept) == HandVsHand::ordinal(ranks));
+}
+
+namespace {
+
+// Writes a complete table where every cell in a row holds the given value
+// and the row number, so partial tables can be tested without the expense
+// of building rows.
+void write_table(const char* filename, uint8_t value)
+{
+   std::vector<HandVsHand::Cell> cells;
+   for (auto i = 0; i < HandVsHand::num_hands; ++i) {
+      cells.insert(cells.end(),
+                   HandVsHand::num_hands,
+                   HandVsHand::Cell{ value, static_cast<uint8_t>(i) });
+   }
+   std::ofstream ostrm(filename, std::ios::binary | std::ios::trunc);
+   ostrm.write(reinterpret_cast<const char*>(cells.data()),
+               cells.size() * sizeof(HandVsHand::Cell));
+}
+
+// Returns true if every cell in the row holds the given value.
+bool row_matches(const HandVsHand& hvh, int pos, uint8_t value)
+{
+   auto row = hvh[pos];
+   return std::all_of(row, row + HandVsHand::num_hands, [&](const auto& cell) {
+      return (cell.dealer_points == value) &&
+             (cell.pone_points == static_cast<uint8_t>(pos));
+   });
+}
+
+} // namespace
+
+TEST_CASE("HandVsHand partial tables")
+{
+   // Save rows [0, 15) from one table and rows [10, 20) from another.
+   write_table("test_hvh.dat", 1);
+   HandVsHand first;
+   REQUIRE(first.load("test_hvh.dat"));
+   REQUIRE(first.is_complete());
+   first.save_partial("test_hvh_part1.dat", 0, 15);
+   write_table("test_hvh.dat", 2);
+   HandVsHand second;
+   REQUIRE(second.load("test_hvh.dat"));
+   second.save_partial("test_hvh_part2.dat", 10, 20);
+
+   // Only the rows in the range are flagged as built.
+   HandVsHand hvh;
+   CHECK(hvh.num_rows_built() == 0);
+   REQUIRE(hvh.load_partial("test_hvh_part2.dat"));
+   CHECK(hvh.num_rows_built() == 10);
+   CHECK(row_matches(hvh, 10, 2));
+   CHECK(row_matches(hvh, 19, 2));
+
+   // Merging adds the rows that aren't built yet and keeps the rest.
+   REQUIRE(hvh.merge("test_hvh_part1.dat"));
+   CHECK(hvh.num_rows_built() == 20);
+   CHECK(!hvh.is_complete());
+   for (auto i = 0; i < 20; ++i) {
+      CAPTURE(i);
+      CHECK(row_matches(hvh, i, (i < 10) ? 1 : 2));
+   }
+
+   // The flags survive a round trip, so built rows are never rebuilt.
+   hvh.save_partial("test_hvh_part1.dat");
+   HandVsHand copy;
+   REQUIRE(copy.load_partial("test_hvh_part1.dat"));
+   CHECK(copy.num_rows_built() == 20);
+   CHECK(row_matches(copy, 0, 1));
+   CHECK(row_matches(copy, 19, 2));
+   CHECK(copy.build(0, 20) == 0);
+
+   // A complete table or a missing file isn't a partial table.
+   CHECK(!copy.load_partial("test_hvh.dat"));
+   CHECK(!copy.merge("test_hvh_missing.dat"));
+   CHECK(copy.num_rows_built() == 20);
+
+   std::remove("test_hvh.dat");
+   std::remove("test_hvh_part1.dat");
+   std::remove("test_hvh_part2.dat");
+}
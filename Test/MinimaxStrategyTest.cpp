@@ -0,0 +1,310 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#include "Catch.hpp"
+#include "MinimaxStrategy.h"
+#include "CardPlayModel.h"
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Wider than any value card play can produce.
+constexpr int infinity = 1000;
+
+// Plain minimax with no pruning and no transposition table.
+int plain_minimax(CardPlayNode& node) noexcept
+{
+   if (node.is_terminal()) {
+      return 0;
+   }
+   auto maximize = node.is_current_player();
+   auto value = maximize ? -infinity : infinity;
+   for (auto play : node.valid_plays()) {
+      auto points = node.points(play);
+      auto undo = node.do_play(play);
+      auto child_value = points + plain_minimax(node);
+      node.undo_play(undo);
+      value = maximize ? std::max(value, child_value)
+                       : std::min(value, child_value);
+   }
+   return value;
+}
+
+// Counts the nodes below the root whose table entry has each kind of bound.
+void count_bounds(const TranspositionTable& table,
+                  CardPlayNode& node,
+                  int& num_lower,
+                  int& num_upper) noexcept
+{
+   if (node.is_terminal()) {
+      return;
+   }
+   switch (table.find(node.key()).bound) {
+      case TranspositionTable::Bound::lower:
+         ++num_lower;
+         break;
+      case TranspositionTable::Bound::upper:
+         ++num_upper;
+         break;
+      default:
+         break;
+   }
+   for (auto play : node.valid_plays()) {
+      auto undo = node.do_play(play);
+      count_bounds(table, node, num_lower, num_upper);
+      node.undo_play(undo);
+   }
+}
+
+// Deals a hand to each player from a shuffled deck.
+void deal(std::mt19937& rng,
+          std::array<RanksInHand, num_players>& hands)
+{
+   std::vector<Rank> deck;
+   for (Rank rank = min_card_rank; rank <= max_card_rank; ++rank) {
+      deck.insert(deck.end(), num_card_suits, rank);
+   }
+   std::shuffle(deck.begin(), deck.end(), rng);
+   auto next = deck.begin();
+   for (auto& hand : hands) {
+      hand.clear();
+      for (auto i = 0; i < num_cards_in_hand; ++i) {
+         hand.push_back(*next++);
+      }
+   }
+}
+
+// Returns the legal play that scores the most points right away. Ties go to
+// the lowest rank.
+Rank greedy_play(const CardPlayModel& model, const RanksInHand& hand)
+{
+   auto best = go_rank;
+   auto best_points = -1;
+   for (Rank rank = min_card_rank; rank <= max_card_rank; ++rank) {
+      if (hand.contains(rank) && model.is_legal_play(rank)) {
+         auto copy = model;
+         auto points = copy.play_rank(rank);
+         if (points > best_points) {
+            best = rank;
+            best_points = points;
+         }
+      }
+   }
+   return best;
+}
+
+// Plays a round of card play between the two strategies with player 0 as the
+// dealer. Returns every play followed by the points each player scored.
+std::vector<int> play_round(std::array<MinimaxStrategy, num_players>& players,
+                            const std::array<RanksInHand, num_players>& hands)
+{
+   players[0].start_new_round(hands[0], true);
+   players[1].start_new_round(hands[1], false);
+   CardPlayModel model(0);
+   std::array<int, num_players> points{};
+   std::vector<int> result;
+   do {
+      auto player = model.current_player();
+      auto play = players[player].get_rank_to_play();
+      points[player] += model.play_rank(play);
+      players[1 - player].on_opponent_play(play);
+      result.push_back(play);
+   } while (!model.round_over());
+   result.insert(result.end(), points.begin(), points.end());
+   return result;
+}
+
+} // namespace
+
+TEST_CASE("alpha_beta", "[minimax]")
+{
+   const auto num_deals = 20;
+   const auto num_windows = 20;
+
+   std::mt19937 rng(42);
+   std::vector<Rank> deck;
+   for (Rank rank = min_card_rank; rank <= max_card_rank; ++rank) {
+      deck.insert(deck.end(), num_card_suits, rank);
+   }
+
+   auto num_lower = 0;
+   auto num_upper = 0;
+   for (auto i = 0; i < num_deals; ++i) {
+      std::shuffle(deck.begin(), deck.end(), rng);
+      RanksInHand observer;
+      RanksInHand opponent;
+      for (auto j = 0; j < num_cards_in_hand; ++j) {
+         observer.push_back(deck[j]);
+         opponent.push_back(deck[num_cards_in_hand + j]);
+      }
+      // Alternate, so both the maximizing and minimizing player go first.
+      CardPlayNode node;
+      node.start_new_round(observer, (i % 2) == 0);
+      node.randomize(opponent);
+      CAPTURE(i);
+
+      auto expected = plain_minimax(node);
+
+      // With a fresh table and a full window, the value must be exact.
+      TranspositionTable table(16);
+      CHECK(alpha_beta(table, node, -infinity, infinity) == expected);
+
+      // Narrow windows leave lower and upper bounds in the table. Each value
+      // must be a valid bound, even when it's built on earlier bounds.
+      table.clear();
+      std::uniform_int_distribution<int> dist(-12, 12);
+      for (auto j = 0; j < num_windows; ++j) {
+         auto alpha = dist(rng);
+         auto beta = alpha + 1 + (dist(rng) + 12) / 4;
+         CAPTURE(alpha, beta);
+         auto value = alpha_beta(table, node, alpha, beta);
+         if (value <= alpha) {
+            CHECK(expected <= value);
+         } else if (value >= beta) {
+            CHECK(expected >= value);
+         } else {
+            CHECK(value == expected);
+         }
+      }
+      count_bounds(table, node, num_lower, num_upper);
+
+      // A full window search that hits those bounds must still be exact.
+      CHECK(alpha_beta(table, node, -infinity, infinity) == expected);
+   }
+
+   CHECK(num_lower > 0);
+   CHECK(num_upper > 0);
+}
+
+TEST_CASE("MinimaxStrategy parallel", "[minimax]")
+{
+   const auto num_deals = 10;
+
+   std::array<MinimaxStrategy, num_players> serial;
+   std::array<MinimaxStrategy, num_players> parallel;
+   for (auto& strategy : parallel) {
+      strategy.set_num_workers(3);
+   }
+
+   std::mt19937 rng(7);
+   std::array<RanksInHand, num_players> hands;
+   for (auto i = 0; i < num_deals; ++i) {
+      deal(rng, hands);
+      CAPTURE(i);
+      CHECK(play_round(parallel, hands) == play_round(serial, hands));
+   }
+}
+
+TEST_CASE("MinimaxStrategy budget", "[minimax]")
+{
+   const auto num_deals = 10;
+
+   std::array<MinimaxStrategy, num_players> unlimited;
+   MinimaxStrategy::Budget large;
+   large.time = std::chrono::hours(1);
+   std::array<MinimaxStrategy, num_players> budgeted = {
+      MinimaxStrategy(false, large),
+      MinimaxStrategy(false, large)
+   };
+   MinimaxStrategy::Budget zero;
+   zero.time = std::chrono::microseconds(0);
+   std::array<MinimaxStrategy, num_players> greedy = {
+      MinimaxStrategy(false, zero),
+      MinimaxStrategy(false, zero)
+   };
+
+   std::mt19937 rng(11);
+   std::array<RanksInHand, num_players> hands;
+   for (auto i = 0; i < num_deals; ++i) {
+      deal(rng, hands);
+      CAPTURE(i);
+
+      // A budget that's never reached searches every hand in batches, which
+      // must add up to the same results as an unlimited search.
+      CHECK(play_round(budgeted, hands) == play_round(unlimited, hands));
+
+      // With no time at all, every decision falls back to the play that
+      // scores the most points right away.
+      greedy[0].start_new_round(hands[0], true);
+      greedy[1].start_new_round(hands[1], false);
+      auto left = hands;
+      CardPlayModel model(0);
+      do {
+         auto player = model.current_player();
+         auto play = greedy[player].get_rank_to_play();
+         CHECK(play == greedy_play(model, left[player]));
+         model.play_rank(play);
+         left[player].remove_first(play);
+         greedy[1 - player].on_opponent_play(play);
+      } while (!model.round_over());
+   }
+}
+
+TEST_CASE("MinimaxStrategy max_hands", "[minimax]")
+{
+   const auto num_deals = 40;
+
+   MinimaxStrategy::Budget budget;
+   budget.max_hands = 1;
+   MinimaxStrategy strategy(false, budget);
+
+   std::mt19937 rng(13);
+   std::array<RanksInHand, num_players> hands;
+   for (auto i = 0; i < num_deals; ++i) {
+      deal(rng, hands);
+      CAPTURE(i);
+
+      // The pone leads, so only the pone's own cards have been seen.
+      RankCounts ranks_seen;
+      for (auto rank : hands[1]) {
+         ranks_seen += rank;
+      }
+      CardPlayHandsIterator opponents(num_cards_in_hand, ranks_seen);
+      auto max_combos = 0;
+      std::vector<RanksInHand> likely;
+      while (opponents.next()) {
+         if (opponents.combos() > max_combos) {
+            max_combos = opponents.combos();
+            likely.clear();
+         }
+         if (opponents.combos() == max_combos) {
+            likely.push_back(opponents.hand());
+         }
+      }
+
+      // Only one of the most likely hands is searched, so the lead must be
+      // the best play against one of them.
+      std::vector<Rank> expected;
+      for (const auto& opponent : likely) {
+         CardPlayNode node;
+         node.start_new_round(hands[1], false);
+         node.randomize(opponent);
+         TranspositionTable table(12);
+         auto best = go_rank;
+         auto best_value = -infinity;
+         for (auto play : node.valid_plays()) {
+            auto points = node.points(play);
+            auto undo = node.do_play(play);
+            auto value = points + alpha_beta(table, node, -infinity, infinity);
+            node.undo_play(undo);
+            if (value > best_value) {
+               best = play;
+               best_value = value;
+            }
+         }
+         expected.push_back(best);
+      }
+
+      strategy.start_new_round(hands[1], false);
+      auto lead = strategy.get_rank_to_play();
+      CHECK(std::find(expected.begin(), expected.end(), lead) !=
+            expected.end());
+   }
+}
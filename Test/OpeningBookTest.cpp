@@ -0,0 +1,119 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#include "Catch.hpp"
+#include "CardPlayHands.h"
+#include "MinimaxStrategy.h"
+#include "OpeningBook.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+TEST_CASE("OpeningBook index")
+{
+   auto hands = CardPlayHands::hands(num_cards_in_hand);
+   auto others = CardPlayHands::hands(OpeningBook::num_others_seen);
+   REQUIRE(hands.size() == OpeningBook::num_hands);
+   REQUIRE(others.size() == OpeningBook::num_others);
+
+   // Every position gets its own entry.
+   const auto num_entries = OpeningBook::num_hands * OpeningBook::num_others;
+   std::vector<bool> used(num_entries, false);
+   auto num_duplicates = 0;
+   auto num_out_of_range = 0;
+   for (const auto& hand : hands) {
+      for (const auto& other : others) {
+         auto i = OpeningBook::index(hand.hand, other.hand);
+         if ((i < 0) || (i >= num_entries)) {
+            ++num_out_of_range;
+            continue;
+         }
+         num_duplicates += used[i];
+         used[i] = true;
+      }
+   }
+   CHECK(num_out_of_range == 0);
+   CHECK(num_duplicates == 0);
+   CHECK(std::all_of(used.begin(), used.end(), [](auto b) { return b; }));
+
+   // Order of the ranks doesn't matter.
+   RanksInHand hand, shuffled;
+   for (auto rank : { 1, 5, 5, 12 }) {
+      hand.push_back(rank);
+   }
+   for (auto rank : { 12, 5, 1, 5 }) {
+      shuffled.push_back(rank);
+   }
+   RanksInHand other;
+   for (auto rank : { 13, 2, 5 }) {
+      other.push_back(rank);
+   }
+   CHECK(OpeningBook::index(hand, other) ==
+         OpeningBook::index(shuffled, other));
+
+   // Hands of the wrong size aren't in the book.
+   CHECK(OpeningBook::index(other, other) == -1);
+   CHECK(OpeningBook::index(hand, hand) == -1);
+}
+
+TEST_CASE("OpeningBook build/save/load")
+{
+   // Building the whole book is far too slow for a test, so only one pone
+   // hand is built. Its ranks are distinct, so every lead has to be searched.
+   const auto pos = 1100;
+   auto hands = CardPlayHands::hands(num_cards_in_hand);
+   auto others = CardPlayHands::hands(OpeningBook::num_others_seen);
+   const auto& hand = hands[pos];
+
+   OpeningBook book;
+   book.build(pos, pos + 1);
+
+   // Leads match a fresh search, and impossible positions aren't in the book.
+   MinimaxStrategy strategy;
+   auto num_possible = 0;
+   for (auto j = 0; j < others.size(); ++j) {
+      const auto& other = others[j].hand;
+      if (hand.counts.remaining_combos(others[j].counts) == 0) {
+         CHECK(book.find(hand.hand, other) == go_rank);
+         continue;
+      }
+      ++num_possible;
+      strategy.start_new_round(hand.hand, false);
+      for (auto rank : other) {
+         strategy.on_rank_seen(rank);
+      }
+      CAPTURE(j);
+      CHECK(book.find(hand.hand, other) == strategy.get_rank_to_play());
+   }
+   REQUIRE(num_possible > 0);
+
+   // Other hands weren't built.
+   CHECK(book.find(hands[pos + 1].hand, others[0].hand) == go_rank);
+
+   // Every entry survives a round trip through a file.
+   book.save("test_book.dat");
+   OpeningBook loaded;
+   REQUIRE(loaded.load("test_book.dat"));
+   auto num_mismatches = 0;
+   for (const auto& h : hands) {
+      for (const auto& other : others) {
+         num_mismatches += (loaded.find(h.hand, other.hand) !=
+                            book.find(h.hand, other.hand));
+      }
+   }
+   CHECK(num_mismatches == 0);
+
+   // A truncated file is rejected.
+   {
+      std::ofstream ostrm("test_book.dat", std::ios::binary | std::ios::trunc);
+      ostrm << "BOOK";
+   }
+   CHECK(!loaded.load("test_book.dat"));
+
+   std::remove("test_book.dat");
+}
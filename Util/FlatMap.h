@@ -0,0 +1,392 @@
+//
+// Copyright 2022 Stephen E. Bensley
+//
+// This file is licensed under the MIT License. You may obtain a copy of the
+// license at https://github.com/stephenbensley/Goosey/blob/main/LICENSE.
+//
+
+#ifndef FlatMap_h
+#define FlatMap_h
+
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Open-addressing hash map for integer keys. The entries are stored in a
+// single array and collisions are resolved by linear probing, so a lookup
+// usually touches a single cache line. One key value is reserved to mark
+// empty slots and can't be inserted.
+//
+// Supports the subset of the std::unordered_map interface used by FileIo.h,
+// so it can be read and written with read_pod_map/write_pod_map.
+template<typename Key,
+         typename T,
+         Key empty_key = std::numeric_limits<Key>::max()>
+class FlatMap
+{
+   static_assert(std::is_integral_v<Key>);
+
+public:
+   using key_type = Key;
+   using mapped_type = T;
+   using value_type = std::pair<Key, T>;
+   using size_type = size_t;
+
+   // Iterates through the occupied slots.
+   template<typename V>
+   class basic_iterator
+   {
+   public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = std::remove_const_t<V>;
+      using difference_type = std::ptrdiff_t;
+      using pointer = V*;
+      using reference = V&;
+
+      basic_iterator(V* pos, V* end) noexcept;
+
+      reference operator*() const noexcept;
+      pointer operator->() const noexcept;
+      basic_iterator& operator++() noexcept;
+      bool operator==(const basic_iterator& rhs) const noexcept;
+      bool operator!=(const basic_iterator& rhs) const noexcept;
+
+   private:
+      // Advances to the next occupied slot.
+      void skip_empty() noexcept;
+
+      V* pos_;
+      V* end_;
+   };
+   using iterator = basic_iterator<value_type>;
+   using const_iterator = basic_iterator<const value_type>;
+
+   FlatMap() noexcept = default;
+   // Bulk construction from a range of key/value pairs. The table is sized
+   // once up front, and if the range is sorted by key, inserts walk the
+   // table in a cache-friendly order.
+   template<typename InputIt>
+   FlatMap(InputIt first, InputIt last);
+
+   iterator begin() noexcept;
+   const_iterator begin() const noexcept;
+   iterator end() noexcept;
+   const_iterator end() const noexcept;
+
+   bool empty() const noexcept;
+   size_type size() const noexcept;
+
+   iterator find(Key key) noexcept;
+   const_iterator find(Key key) const noexcept;
+   bool contains(Key key) const noexcept;
+
+   // Inserts a default value if the key isn't present.
+   T& operator[](Key key);
+   // Returns false if the key was already present.
+   bool insert(const value_type& value);
+
+   // Makes room for at least count entries without rehashing.
+   void reserve(size_type count);
+   void clear() noexcept;
+   void swap(FlatMap& other) noexcept;
+
+   // Shrinks the table to the smallest size that meets the load factor and
+   // marks it read-only. Any further modification is a bug.
+   void freeze();
+   bool frozen() const noexcept;
+
+private:
+   // The table is at most half full, which keeps probe sequences short.
+   static constexpr size_type min_capacity = 16;
+   static size_type capacity_for(size_type count) noexcept;
+
+   // Integer mixer, so that keys with structure in the low bits (e.g., keys
+   // built from ranks) are spread across the whole table.
+   static uint64_t mix(uint64_t x) noexcept;
+
+   // Returns the slot holding the key or the empty slot where it belongs.
+   size_type probe(Key key) const noexcept;
+   // Rebuilds the table with the given capacity, which must be a power of 2.
+   void rehash(size_type capacity);
+
+   std::vector<value_type> slots_;
+   size_type size_ = 0;
+   bool frozen_ = false;
+};
+
+template<typename Key, typename T, Key empty_key>
+template<typename V>
+inline FlatMap<Key, T, empty_key>::basic_iterator<V>::basic_iterator(
+   V* pos,
+   V* end
+) noexcept
+: pos_(pos),
+  end_(end)
+{
+   skip_empty();
+}
+
+template<typename Key, typename T, Key empty_key>
+template<typename V>
+inline auto FlatMap<Key, T, empty_key>::basic_iterator<V>::operator*() const
+noexcept -> reference
+{
+   return *pos_;
+}
+
+template<typename Key, typename T, Key empty_key>
+template<typename V>
+inline auto FlatMap<Key, T, empty_key>::basic_iterator<V>::operator->() const
+noexcept -> pointer
+{
+   return pos_;
+}
+
+template<typename Key, typename T, Key empty_key>
+template<typename V>
+inline auto FlatMap<Key, T, empty_key>::basic_iterator<V>::operator++()
+noexcept -> basic_iterator&
+{
+   ++pos_;
+   skip_empty();
+   return *this;
+}
+
+template<typename Key, typename T, Key empty_key>
+template<typename V>
+inline bool FlatMap<Key, T, empty_key>::basic_iterator<V>::operator==(
+   const basic_iterator& rhs
+) const noexcept
+{
+   return pos_ == rhs.pos_;
+}
+
+template<typename Key, typename T, Key empty_key>
+template<typename V>
+inline bool FlatMap<Key, T, empty_key>::basic_iterator<V>::operator!=(
+   const basic_iterator& rhs
+) const noexcept
+{
+   return pos_ != rhs.pos_;
+}
+
+template<typename Key, typename T, Key empty_key>
+template<typename V>
+inline void FlatMap<Key, T, empty_key>::basic_iterator<V>::skip_empty()
+noexcept
+{
+   while ((pos_ != end_) && (pos_->first == empty_key)) {
+      ++pos_;
+   }
+}
+
+template<typename Key, typename T, Key empty_key>
+template<typename InputIt>
+FlatMap<Key, T, empty_key>::FlatMap(InputIt first, InputIt last)
+{
+   reserve(std::distance(first, last));
+   for (; first != last; ++first) {
+      insert(*first);
+   }
+}
+
+template<typename Key, typename T, Key empty_key>
+inline auto FlatMap<Key, T, empty_key>::begin() noexcept -> iterator
+{
+   return iterator(slots_.data(), slots_.data() + slots_.size());
+}
+
+template<typename Key, typename T, Key empty_key>
+inline auto FlatMap<Key, T, empty_key>::begin() const noexcept
+-> const_iterator
+{
+   return const_iterator(slots_.data(), slots_.data() + slots_.size());
+}
+
+template<typename Key, typename T, Key empty_key>
+inline auto FlatMap<Key, T, empty_key>::end() noexcept -> iterator
+{
+   auto end = slots_.data() + slots_.size();
+   return iterator(end, end);
+}
+
+template<typename Key, typename T, Key empty_key>
+inline auto FlatMap<Key, T, empty_key>::end() const noexcept -> const_iterator
+{
+   auto end = slots_.data() + slots_.size();
+   return const_iterator(end, end);
+}
+
+template<typename Key, typename T, Key empty_key>
+inline bool FlatMap<Key, T, empty_key>::empty() const noexcept
+{
+   return size_ == 0;
+}
+
+template<typename Key, typename T, Key empty_key>
+inline size_t FlatMap<Key, T, empty_key>::size() const noexcept
+{
+   return size_;
+}
+
+template<typename Key, typename T, Key empty_key>
+inline auto FlatMap<Key, T, empty_key>::find(Key key) noexcept -> iterator
+{
+   if (slots_.empty()) {
+      return end();
+   }
+   auto pos = probe(key);
+   if (slots_[pos].first == empty_key) {
+      return end();
+   }
+   return iterator(slots_.data() + pos, slots_.data() + slots_.size());
+}
+
+template<typename Key, typename T, Key empty_key>
+inline auto FlatMap<Key, T, empty_key>::find(Key key) const noexcept
+-> const_iterator
+{
+   if (slots_.empty()) {
+      return end();
+   }
+   auto pos = probe(key);
+   if (slots_[pos].first == empty_key) {
+      return end();
+   }
+   return const_iterator(slots_.data() + pos, slots_.data() + slots_.size());
+}
+
+template<typename Key, typename T, Key empty_key>
+inline bool FlatMap<Key, T, empty_key>::contains(Key key) const noexcept
+{
+   return find(key) != end();
+}
+
+template<typename Key, typename T, Key empty_key>
+T& FlatMap<Key, T, empty_key>::operator[](Key key)
+{
+   assert(!frozen_);
+   assert(key != empty_key);
+   if (capacity_for(size_ + 1) > slots_.size()) {
+      rehash(capacity_for(size_ + 1));
+   }
+   auto& slot = slots_[probe(key)];
+   if (slot.first == empty_key) {
+      slot = { key, T() };
+      ++size_;
+   }
+   return slot.second;
+}
+
+template<typename Key, typename T, Key empty_key>
+bool FlatMap<Key, T, empty_key>::insert(const value_type& value)
+{
+   assert(!frozen_);
+   assert(value.first != empty_key);
+   if (capacity_for(size_ + 1) > slots_.size()) {
+      rehash(capacity_for(size_ + 1));
+   }
+   auto& slot = slots_[probe(value.first)];
+   if (slot.first != empty_key) {
+      return false;
+   }
+   slot = value;
+   ++size_;
+   return true;
+}
+
+template<typename Key, typename T, Key empty_key>
+void FlatMap<Key, T, empty_key>::reserve(size_type count)
+{
+   assert(!frozen_);
+   if (capacity_for(count) > slots_.size()) {
+      rehash(capacity_for(count));
+   }
+}
+
+template<typename Key, typename T, Key empty_key>
+inline void FlatMap<Key, T, empty_key>::clear() noexcept
+{
+   slots_.clear();
+   size_ = 0;
+   frozen_ = false;
+}
+
+template<typename Key, typename T, Key empty_key>
+inline void FlatMap<Key, T, empty_key>::swap(FlatMap& other) noexcept
+{
+   slots_.swap(other.slots_);
+   std::swap(size_, other.size_);
+   std::swap(frozen_, other.frozen_);
+}
+
+template<typename Key, typename T, Key empty_key>
+void FlatMap<Key, T, empty_key>::freeze()
+{
+   if (capacity_for(size_) < slots_.size()) {
+      rehash(capacity_for(size_));
+   }
+   slots_.shrink_to_fit();
+   frozen_ = true;
+}
+
+template<typename Key, typename T, Key empty_key>
+inline bool FlatMap<Key, T, empty_key>::frozen() const noexcept
+{
+   return frozen_;
+}
+
+template<typename Key, typename T, Key empty_key>
+inline size_t FlatMap<Key, T, empty_key>::capacity_for(size_type count)
+noexcept
+{
+   auto capacity = min_capacity;
+   while (capacity < (2 * count)) {
+      capacity *= 2;
+   }
+   return capacity;
+}
+
+template<typename Key, typename T, Key empty_key>
+inline uint64_t FlatMap<Key, T, empty_key>::mix(uint64_t x) noexcept
+{
+   // Finalizer from MurmurHash3.
+   x ^= x >> 33;
+   x *= 0xff51afd7ed558ccd;
+   x ^= x >> 33;
+   x *= 0xc4ceb9fe1a85ec53;
+   x ^= x >> 33;
+   return x;
+}
+
+template<typename Key, typename T, Key empty_key>
+inline size_t FlatMap<Key, T, empty_key>::probe(Key key) const noexcept
+{
+   assert(!slots_.empty());
+   const auto mask = slots_.size() - 1;
+   auto pos = static_cast<size_type>(mix(static_cast<uint64_t>(key))) & mask;
+   while ((slots_[pos].first != key) && (slots_[pos].first != empty_key)) {
+      pos = (pos + 1) & mask;
+   }
+   return pos;
+}
+
+template<typename Key, typename T, Key empty_key>
+void FlatMap<Key, T, empty_key>::rehash(size_type capacity)
+{
+   assert((capacity & (capacity - 1)) == 0);
+   assert(capacity >= capacity_for(size_));
+   std::vector<value_type> old(capacity, value_type(empty_key, T()));
+   old.swap(slots_);
+   for (const auto& slot : old) {
+      if (slot.first != empty_key) {
+         slots_[probe(slot.first)] = slot;
+      }
+   }
+}
+
+#endif /* FlatMap_h */
@@ -25,7 +25,7 @@ public:
    using iterator = T*;
    using const_iterator = const T*;
 
-   SizedArray() noexcept = default;
+   constexpr SizedArray() noexcept = default;
 
    explicit SizedArray(size_type count, const T& value = T())
    {
@@ -33,28 +33,13 @@ public:
       std::fill(begin(), end(), value);
    }
 
-   SizedArray(const SizedArray& other) noexcept
-   : data_(other.data_)
-   {
-      end_ = begin() + other.size();
-   }
-
-   SizedArray& operator=(const SizedArray& rhs) noexcept
-   {
-      if (this != &rhs) {
-         data_ = rhs.data_;
-         end_ = begin() + rhs.size();
-      }
-      return *this;
-   }
-
-   reference operator[](size_type pos) noexcept
+   constexpr reference operator[](size_type pos) noexcept
    {
       assert(pos < size());
       return data_[pos];
    }
 
-   const_reference operator[](size_type pos) const noexcept
+   constexpr const_reference operator[](size_type pos) const noexcept
    {
       assert(pos < size());
       return data_[pos];
@@ -75,13 +60,13 @@ public:
    reference back() noexcept
    {
       assert(!empty());
-      return *(end_ - 1);
+      return data_[size_ - 1];
    }
 
    const_reference back() const noexcept
    {
       assert(!empty());
-      return *(end_ - 1);
+      return data_[size_ - 1];
    }
 
    const std::array<T, N>& data() const noexcept
@@ -90,24 +75,24 @@ public:
       return data_;
    }
    
-   iterator begin() noexcept
+   constexpr iterator begin() noexcept
    {
       return data_.begin();
    }
 
-   const_iterator begin() const noexcept
+   constexpr const_iterator begin() const noexcept
    {
       return data_.begin();
    }
 
-   iterator end() noexcept
+   constexpr iterator end() noexcept
    {
-      return end_;
+      return data_.begin() + size_;
    }
 
-   const_iterator end() const noexcept
+   constexpr const_iterator end() const noexcept
    {
-      return end_;
+      return data_.begin() + size_;
    }
 
    bool contains(const_reference value) const noexcept
@@ -115,54 +100,55 @@ public:
       return std::find(begin(), end(), value) != end();
    }
 
-   bool empty() const noexcept
+   constexpr bool empty() const noexcept
    {
-      return begin() == end();
+      return size_ == 0;
    }
 
-   size_type size() const noexcept
+   constexpr size_type size() const noexcept
    {
-      return std::distance(begin(), end());
+      return size_;
    }
 
-   size_type capacity() const noexcept
+   constexpr size_type capacity() const noexcept
    {
       return N;
    }
 
    void clear() noexcept
    {
-      end_ = begin();
+      size_ = 0;
    }
    
-   void push_back(const_reference value) noexcept
+   constexpr void push_back(const_reference value) noexcept
    {
       assert(size() < N);
-      *end_++ = value;
+      data_[size_++] = value;
    }
 
    void pop_back() noexcept
    {
       assert(!empty());
-      --end_;
+      --size_;
    }
 
    size_type erase(const_reference value) noexcept
    {
-      auto old_end = end_;
-      end_ = std::remove(begin(), end(), value);
-      return std::distance(end_, old_end);
+      auto old_size = size_;
+      size_ = std::distance(begin(), std::remove(begin(), end(), value));
+      return old_size - size_;
    }
 
    size_type erase(const_iterator begin, const_iterator end) noexcept
    {
-      auto old_end = end_;
-      end_ = std::remove_if(this->begin(),
-                            this->end(),
-                            [begin, end](const auto& value) {
+      auto old_size = size_;
+      auto new_end = std::remove_if(this->begin(),
+                                    this->end(),
+                                    [begin, end](const auto& value) {
          return std::find(begin, end, value) != end;
       });
-      return std::distance(end_, old_end);
+      size_ = std::distance(this->begin(), new_end);
+      return old_size - size_;
    }
 
    void insert(const_reference value) noexcept
@@ -188,12 +174,15 @@ public:
 
    void resize(size_type new_size) noexcept
    {
-      end_ = data_.begin() + new_size;
+      assert(new_size <= N);
+      size_ = new_size;
    }
 
 private:
-   std::array<T, N> data_;
-   T* end_ = data_.begin();
+   // Storing a size rather than an end pointer keeps SizedArray trivially
+   // copyable and usable in constant expressions.
+   std::array<T, N> data_{};
+   size_type size_ = 0;
 };
 
 #endif /* SizedArray_h */